@@ -13,16 +13,25 @@
 #                 Use %i/%o placeholders for file-argument tools:
 #                   -o "myc:./compress %i %o:./decompress %i %o"
 #                 Without placeholders, stdin/stdout is used (gzip-style -c tools).
+#   -n            Leave out our own coders (arith1*, arith2*), registered by default
+#   -T THREADS    Thread counts swept for parallel modes (arith2 -j), comma-
+#                 separated (default: 1,2,4,... up to the CPUs available)
+#   -p CPUS       Pin runs to CPUS: "auto" (default; one CPU per thread of the
+#                 run, taken from the allowed set), "none", or a taskset list
 #   -r RUNS       Number of timing runs per compressor (default: 1)
 #   -q            Quiet — suppress progress output, only show final table
 #   -h            Show this help
 #
+# Every run goes through /usr/bin/time: wall time (%e) and user/sys CPU time
+# (%U/%S) are averaged over RUNS, max RSS (%M) is the largest seen.
+#
 # Examples:
 #   ./benchmark.sh                          # test all files individually
 #   ./benchmark.sh -c                       # concatenate A-H (matches prof table)
 #   ./benchmark.sh -c -o "ox:./ox -c:./ox -d"
 #   ./benchmark.sh -c -o "myc:./compress %i %o:./decompress %i %o"
 #   ./benchmark.sh -f C,D -r 3             # test files C and D, 3 timing runs
+#   ./benchmark.sh -c -T 1,4,8 -p none      # thread sweep without pinning
 # =============================================================================
 
 set -euo pipefail
@@ -32,8 +41,12 @@ DATA_DIR="data"
 FILES_ARG="A,B,C,D,E,F,G,H"
 CONCAT_MODE=false
 OWN_TOOL=""
+OWN_CODERS=true
+THREADS_ARG=""
+PIN="auto"
 RUNS=1
 QUIET=false
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 
 # ---------- ANSI colours -----------------------------------------------------
 R='\033[0;31m'; G='\033[0;32m'; Y='\033[1;33m'
@@ -44,37 +57,89 @@ warn() { printf "${Y}[warn] ${N}%s\n" "$*" >&2; }
 err()  { printf "${R}[error]${N} %s\n" "$*" >&2; exit 1; }
 
 # ---------- arg parsing ------------------------------------------------------
-while getopts "d:f:co:r:qh" opt; do
+while getopts "d:f:co:nT:p:r:qh" opt; do
     case $opt in
         d) DATA_DIR="$OPTARG" ;;
         f) FILES_ARG="$OPTARG" ;;
         c) CONCAT_MODE=true ;;
         o) OWN_TOOL="$OPTARG" ;;
+        n) OWN_CODERS=false ;;
+        T) THREADS_ARG="$OPTARG" ;;
+        p) PIN="$OPTARG" ;;
         r) RUNS="$OPTARG" ;;
         q) QUIET=true ;;
-        h) sed -n '2,30p' "$0"; exit 0 ;;
+        h) sed -n '2,40p' "$0"; exit 0 ;;
         *) err "Unknown option -$OPTARG. Use -h for help." ;;
     esac
 done
 
 # ---------- dependencies check -----------------------------------------------
-for bin in gzip bzip2 xz zstd bc md5sum; do
+for bin in gzip bzip2 xz zstd md5sum; do
     command -v "$bin" &>/dev/null || err "Required tool not found: $bin"
 done
 # /usr/bin/time (not the shell builtin) needed for -f flag
 TIME_CMD="/usr/bin/time"
 [[ -x "$TIME_CMD" ]] || err "/usr/bin/time not found (needed for timing)"
+if [[ "$PIN" != "none" ]] && ! command -v taskset &>/dev/null; then
+    warn "taskset not found; runs are not pinned"
+    PIN="none"
+fi
+
+# ---------- CPUs and thread counts -------------------------------------------
+# CPUs this process may run on, one per line ("0-3,6" expanded)
+allowed_cpus() {
+    local list
+    list=$(taskset -cp $$ 2>/dev/null | sed 's/.*: *//') || list=""
+    [[ -n "$list" ]] || list="0-$(( $(nproc) - 1 ))"
+    local part
+    IFS=',' read -ra parts <<< "$list"
+    for part in "${parts[@]}"; do
+        if [[ "$part" == *-* ]]; then
+            seq "${part%-*}" "${part#*-}"
+        else
+            echo "$part"
+        fi
+    done
+}
+
+if [[ "$PIN" != "none" ]]; then
+    mapfile -t CPUS < <(allowed_cpus)
+else
+    mapfile -t CPUS < <(seq 0 $(( $(nproc) - 1 )))
+fi
+
+if [[ -n "$THREADS_ARG" ]]; then
+    IFS=',' read -ra THREAD_LIST <<< "$THREADS_ARG"
+else
+    THREAD_LIST=()
+    for (( t=1; t<${#CPUS[@]}; t*=2 )); do THREAD_LIST+=("$t"); done
+    THREAD_LIST+=("${#CPUS[@]}")
+fi
+
+# taskset CPU list for a run with the given thread count
+pin_list() {
+    local threads="$1"
+    case "$PIN" in
+        none) echo "" ;;
+        auto)
+            (( threads > ${#CPUS[@]} )) && threads=${#CPUS[@]}
+            (IFS=','; echo "${CPUS[*]:${#CPUS[@]}-threads:threads}") ;;
+        *) echo "$PIN" ;;
+    esac
+}
 
 # ---------- compressor definitions -------------------------------------------
-# Arrays: NAMES, COMP_CMDS, DECOMP_CMDS
+# Arrays: NAMES, COMP_CMDS, DECOMP_CMDS, THREADS (CPUs a run is pinned to)
 NAMES=()
 COMP_CMDS=()
 DECOMP_CMDS=()
+THREADS=()
 
 add_compressor() {
     NAMES+=("$1")
     COMP_CMDS+=("$2")
     DECOMP_CMDS+=("$3")
+    THREADS+=("${4:-1}")
 }
 
 add_compressor "gzip"     "gzip -6 -c"          "gzip -d -c"
@@ -87,6 +152,35 @@ add_compressor "zstd-1"   "zstd -1 -q -c"        "zstd -d -q -c"
 add_compressor "zstd-3"   "zstd -3 -q -c"        "zstd -d -q -c"
 add_compressor "zstd-19"  "zstd -19 -q -c"       "zstd -d -q -c"
 
+# Our coders, built like scripts/run_arithmetic_encoder_*.sh do when missing
+# or older than their sources
+build_coder() {
+    local bin="$ROOT_DIR/$1"
+    if [[ ! -x "$bin" ]] || [[ -n "$(find "$ROOT_DIR/src/coder" "$ROOT_DIR/src/common" "$ROOT_DIR/src/transform" \
+            -newer "$bin" -name '*.[ch]*' -print -quit)" ]]; then
+        log "Building $1 ..."
+        g++ -std=c++17 -O3 -pthread -o "$bin" "$ROOT_DIR/src/coder/$1.cpp" || err "Cannot build $1"
+    fi
+}
+
+if $OWN_CODERS; then
+    build_coder arithmetic_encoder_1
+    build_coder arithmetic_encoder_2
+    ENC1="\"$ROOT_DIR/arithmetic_encoder_1\""
+    ENC2="\"$ROOT_DIR/arithmetic_encoder_2\""
+    add_compressor "arith1"          "$ENC1 %i %o"    "$ENC1 -d %i %o"
+    add_compressor "arith1-wide"     "$ENC1 -w %i %o" "$ENC1 -d %i %o"
+    add_compressor "arith1-adaptive" "$ENC1 -a %i %o" "$ENC1 -d %i %o"
+    add_compressor "arith1-cm"       "$ENC1 -m %i %o" "$ENC1 -d %i %o"
+    add_compressor "arith1-x"        "$ENC1 -x %i %o" "$ENC1 -d %i %o"
+    # Block-parallel in both directions on every CPU it is given
+    add_compressor "arith1-split"    "$ENC1 -b %i %o" "$ENC1 -d %i %o" "${#CPUS[@]}"
+    add_compressor "arith2"          "$ENC2 c %i %o"  "$ENC2 d %i %o"
+    for t in "${THREAD_LIST[@]}"; do
+        add_compressor "arith2-j$t"  "$ENC2 c -j $t %i %o" "$ENC2 d %i %o" "$t"
+    done
+fi
+
 # Append user's own tool if provided
 if [[ -n "$OWN_TOOL" ]]; then
     IFS=':' read -r own_name own_comp own_decomp <<< "$OWN_TOOL"
@@ -104,13 +198,40 @@ fmt3()         { awk "BEGIN{printf \"%.3f\", $1}"; }   # format to 3 dp, leading
 # Supports two calling conventions:
 #   - stdin/stdout (default): comp_cmd < input > output  (gzip -c style)
 #   - file-argument mode:     comp_cmd input output       (use %i/%o placeholders)
-# Outputs one result row: comp_bytes t_comp t_decomp lossless
+# Each run is pinned to the CPUs pin_list gives for the row's thread count.
+# Outputs one result row:
+#   comp_bytes t_comp usr_comp sys_comp rss_comp t_decomp usr_decomp sys_decomp rss_decomp lossless
+
+# Runs a command RUNS times under /usr/bin/time; prints "wall usr sys rss_kb"
+# (times averaged, RSS the maximum) or fails if any run fails.
+timed_runs() {
+    local cpus="$1" file_args="$2" cmd="$3" in="$4" out="$5"
+    local tfile i
+    tfile=$(mktemp)
+    local -a pin=()
+    [[ -n "$cpus" ]] && pin=(taskset -c "$cpus")
+    for (( i=0; i<RUNS; i++ )); do
+        if $file_args; then
+            ${pin[@]+"${pin[@]}"} "$TIME_CMD" -a -f "%e %U %S %M" -o "$tfile" \
+                bash -c "$cmd" > /dev/null 2>/dev/null \
+                || { rm -f "$tfile"; return 1; }
+        else
+            ${pin[@]+"${pin[@]}"} "$TIME_CMD" -a -f "%e %U %S %M" -o "$tfile" \
+                bash -c "$cmd < \"\$0\" > \"\$1\"" "$in" "$out" 2>/dev/null \
+                || { rm -f "$tfile"; return 1; }
+        fi
+    done
+    awk '{ e += $1; u += $2; s += $3; if ($4 > m) m = $4 }
+         END { printf "%.3f %.3f %.3f %d\n", e/NR, u/NR, s/NR, m }' "$tfile"
+    rm -f "$tfile"
+}
+
 bench_one() {
-    local input="$1" name="$2" comp_cmd="$3" decomp_cmd="$4"
-    local tmpcomp tmpdecomp tfile
+    local input="$1" name="$2" comp_cmd="$3" decomp_cmd="$4" threads="$5"
+    local tmpcomp tmpdecomp cpus
     tmpcomp=$(mktemp)
     tmpdecomp=$(mktemp)
-    tfile=$(mktemp)
+    cpus=$(pin_list "$threads")
 
     # Detect file-argument mode via %i/%o placeholders
     local file_args_c=false file_args_d=false
@@ -123,64 +244,38 @@ bench_one() {
     actual_decomp="${decomp_cmd//%i/$tmpcomp}"; actual_decomp="${actual_decomp//%o/$tmpdecomp}"
 
     # --- compress (exactly RUNS runs, averaged) ---
-    local t_comp="0.000"
+    local comp_stats="0.000 0.000 0.000 0"
     local comp_ok=true
-    local sum_c=0 i t
-    for (( i=0; i<RUNS; i++ )); do
-        if $file_args_c; then
-            "$TIME_CMD" -f "%e" -o "$tfile" bash -c "$actual_comp" > /dev/null 2>/dev/null \
-                || { comp_ok=false; break; }
-        else
-            "$TIME_CMD" -f "%e" -o "$tfile" bash -c "$actual_comp < \"\$0\" > \"\$1\"" \
-                "$input" "$tmpcomp" 2>/dev/null \
-                || { comp_ok=false; break; }
-        fi
-        t=$(cat "$tfile")
-        sum_c=$(echo "$sum_c + $t" | bc)
-    done
-    if $comp_ok; then
-        t_comp=$(echo "scale=3; $sum_c / $RUNS" | bc)
-    fi
+    comp_stats=$(timed_runs "$cpus" "$file_args_c" "$actual_comp" "$input" "$tmpcomp") \
+        || { comp_ok=false; comp_stats="0.000 0.000 0.000 0"; }
 
     local comp_bytes
     comp_bytes=$(stat -c%s "$tmpcomp" 2>/dev/null || echo 0)
 
     # --- decompress (exactly RUNS runs, averaged) ---
-    local t_decomp="0.000"
+    local decomp_stats="0.000 0.000 0.000 0"
     local lossless="NO"
     if $comp_ok && [[ "$comp_bytes" -gt 0 ]]; then
-        local sum_d=0
-        local decomp_ok=true
-        for (( i=0; i<RUNS; i++ )); do
-            if $file_args_d; then
-                "$TIME_CMD" -f "%e" -o "$tfile" bash -c "$actual_decomp" > /dev/null 2>/dev/null \
-                    || { decomp_ok=false; break; }
-            else
-                "$TIME_CMD" -f "%e" -o "$tfile" bash -c "$actual_decomp < \"\$0\" > \"\$1\"" \
-                    "$tmpcomp" "$tmpdecomp" 2>/dev/null \
-                    || { decomp_ok=false; break; }
-            fi
-            t=$(cat "$tfile")
-            sum_d=$(echo "$sum_d + $t" | bc)
-        done
-        if $decomp_ok; then
-            t_decomp=$(echo "scale=3; $sum_d / $RUNS" | bc)
+        if decomp_stats=$(timed_runs "$cpus" "$file_args_d" "$actual_decomp" "$tmpcomp" "$tmpdecomp"); then
             # Lossless check via md5
             local md5_orig md5_decomp
             md5_orig=$(md5sum "$input" | cut -d' ' -f1)
             md5_decomp=$(md5sum "$tmpdecomp" | cut -d' ' -f1)
             [[ "$md5_orig" == "$md5_decomp" ]] && lossless="YES" || lossless="NO"
+        else
+            decomp_stats="0.000 0.000 0.000 0"
         fi
     fi
 
-    rm -f "$tmpcomp" "$tmpdecomp" "$tfile"
-    echo "$comp_bytes $t_comp $t_decomp $lossless"
+    rm -f "$tmpcomp" "$tmpdecomp"
+    echo "$comp_bytes $comp_stats $decomp_stats $lossless"
 }
 
 # ---------- print a separator ------------------------------------------------
 separator() {
-    printf '+------+%-16s+%-14s+%-14s+--------+-----------+-----------+-----------+-----------+-----------+\n' \
-        "----------------" "--------------" "--------------"
+    printf '+------+%-16s+-----+%-14s+%-14s+--------+-----------+-----------+-----------+-----------+' \
+        "------------------" "--------------" "--------------"
+    printf -- '---------+---------+---------+---------+-----------+-----------+-----------+\n'
 }
 
 # ---------- print table header -----------------------------------------------
@@ -189,9 +284,10 @@ print_header() {
     echo ""
     printf "${W}%s${N}\n" "$label"
     separator
-    printf '| %-4s | %-14s | %-12s | %-12s | %-6s | %-9s | %-9s | %-9s | %-9s | %-9s |\n' \
-        "Rank" "Compressor" "Original(MB)" "Comprssd(MB)" "Ratio%" \
-        "bits/byte" "t_comp(s)" "t_dcp(s)" "t_total(s)" "Lossless"
+    printf '| %-4s | %-16s | %-3s | %-12s | %-12s | %-6s | %-9s | %-9s | %-9s | %-9s | %-7s | %-7s | %-7s | %-7s | %-9s | %-9s | %-9s |\n' \
+        "Rank" "Compressor" "Thr" "Original(MB)" "Comprssd(MB)" "Ratio%" \
+        "bits/byte" "t_comp(s)" "t_dcp(s)" "t_total(s)" "usr_c" "sys_c" "usr_d" "sys_d" \
+        "RSS_c(MB)" "RSS_d(MB)" "Lossless"
     separator
 }
 
@@ -206,20 +302,24 @@ bench_file() {
 
     log "Benchmarking: $label  ($(printf '%s' "$orig_mb") MB, $orig_bytes bytes)"
 
-    # Collect rows: name comp_bytes t_comp t_decomp lossless
-    local -a rows_name rows_comp rows_tc rows_td rows_lossless
+    # Collect rows: name threads comp_bytes, wall/usr/sys/RSS for both
+    # directions, lossless
+    local -a rows_name rows_thr rows_comp rows_tc rows_uc rows_sc rows_mc
+    local -a rows_td rows_ud rows_sd rows_md rows_lossless
 
     local i
     for (( i=0; i<${#NAMES[@]}; i++ )); do
         local name="${NAMES[$i]}"
         local cc="${COMP_CMDS[$i]}"
         local dc="${DECOMP_CMDS[$i]}"
+        local thr="${THREADS[$i]}"
         log "  -> $name ..."
-        read -r cb tc td ls <<< "$(bench_one "$input" "$name" "$cc" "$dc")"
+        read -r cb tc uc sc mc td ud sd md ls <<< "$(bench_one "$input" "$name" "$cc" "$dc" "$thr")"
         rows_name+=("$name")
+        rows_thr+=("$thr")
         rows_comp+=("$cb")
-        rows_tc+=("$tc")
-        rows_td+=("$td")
+        rows_tc+=("$tc"); rows_uc+=("$uc"); rows_sc+=("$sc"); rows_mc+=("$mc")
+        rows_td+=("$td"); rows_ud+=("$ud"); rows_sd+=("$sd"); rows_md+=("$md")
         rows_lossless+=("$ls")
     done
 
@@ -244,6 +344,9 @@ bench_file() {
         local tc="${rows_tc[$idx]}"
         local td="${rows_td[$idx]}"
         local ls="${rows_lossless[$idx]}"
+        local rss_c rss_d
+        rss_c=$(awk "BEGIN{printf \"%.1f\", ${rows_mc[$idx]}/1024}")
+        rss_d=$(awk "BEGIN{printf \"%.1f\", ${rows_md[$idx]}/1024}")
 
         local comp_mb ratio bps tt
         comp_mb=$(bytes_to_mb "$cb")
@@ -256,9 +359,10 @@ bench_file() {
         local lossless_mark
         [[ "$ls" == "YES" ]] && lossless_mark="${G}YES${N}" || lossless_mark="${R}NO ${N}"
 
-        printf "| %-4s | %-14s | %12s | %12s | %6s | %9s | %9s | %9s | %9s | %-9b |\n" \
-            "$rank" "$name" "$orig_mb" "$comp_mb" "${ratio}%" \
-            "$bps" "$tc" "$td" "$tt" "$lossless_mark"
+        printf "| %-4s | %-16s | %3s | %12s | %12s | %6s | %9s | %9s | %9s | %9s | %7s | %7s | %7s | %7s | %9s | %9s | %-9b |\n" \
+            "$rank" "$name" "${rows_thr[$idx]}" "$orig_mb" "$comp_mb" "${ratio}%" \
+            "$bps" "$tc" "$td" "$tt" "${rows_uc[$idx]}" "${rows_sc[$idx]}" \
+            "${rows_ud[$idx]}" "${rows_sd[$idx]}" "$rss_c" "$rss_d" "$lossless_mark"
 
         (( rank++ ))
     done
@@ -283,6 +387,7 @@ echo ""
 printf "${W}========================================================${N}\n"
 printf "${W}  TAI Project 1 — Compression Benchmark${N}\n"
 printf "${W}  Runs per compressor: $RUNS${N}\n"
+printf "${W}  CPU pinning: %s${N}\n" "$PIN"
 printf "${W}========================================================${N}\n"
 
 if $CONCAT_MODE; then
@@ -0,0 +1,17 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Builds and runs src/check/archive_reader_check.cpp: tai::ArchiveReader over
+# an ARIS archive with a two-frame FrameCache, checking the bytes, the cap
+# and the hit/miss counts of a fixed read order and of concurrent readers.
+# Exits 1 if any check fails.
+#   ./scripts/check_archive_reader.sh
+
+script_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+root_dir="$(cd "$script_dir/.." && pwd)"
+
+tmp="$(mktemp -d)"
+trap 'rm -rf "$tmp"' EXIT
+
+g++ -std=c++17 -O2 -pthread -o "$tmp/check" "$root_dir/src/check/archive_reader_check.cpp"
+"$tmp/check" "$tmp/archive.aris"
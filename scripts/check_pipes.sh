@@ -0,0 +1,70 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Round-trips every format of both coders through pipes: each file is
+# compressed by path and decoded from stdin (cat | tool), and the filter
+# modes (-c) are chained end to end. Exits 1 if any output differs.
+#   ./scripts/check_pipes.sh
+
+script_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+root_dir="$(cd "$script_dir/.." && pwd)"
+
+# Build binaries if missing or older than any source they compile in
+for tool in arithmetic_encoder_1 arithmetic_encoder_2; do
+  tool_bin="$root_dir/$tool"
+  if [[ ! -x "$tool_bin" ]] || [[ -n "$(find "$root_dir/src/coder" "$root_dir/src/common" "$root_dir/src/transform" -newer "$tool_bin" -name '*.[ch]*' -print -quit)" ]]; then
+    g++ -std=c++17 -O3 -pthread -o "$tool_bin" "$root_dir/src/coder/$tool.cpp"
+  fi
+done
+enc1="$root_dir/arithmetic_encoder_1"
+enc2="$root_dir/arithmetic_encoder_2"
+
+tmp="$(mktemp -d)"
+trap 'rm -rf "$tmp"' EXIT
+
+# Inputs: text (over one parallel segment), random bytes, a small file
+# (compact/small paths), CSV (field split) and x86 code (E8/E9 filter).
+: > "$tmp/text"
+while (( $(stat -c%s "$tmp/text") < 1200000 )); do cat "$root_dir/README.md" >> "$tmp/text"; done
+truncate -s 1200000 "$tmp/text"
+head -c 200000 /dev/urandom > "$tmp/random"
+head -c 1000 "$tmp/text" > "$tmp/small"
+awk 'BEGIN { srand(1); for (i = 0; i < 40000; i++) printf "%d,%d,name%d,%.4f\n", i, int(rand() * 1000), int(rand() * 50), rand() }' > "$tmp/csv"
+cp "$enc2" "$tmp/x86"
+inputs=(text random small csv x86)
+
+failed=0
+check() {
+  local name="$1" input="$2" output="$3"
+  if cmp -s "$input" "$output"; then
+    echo "ok    $name"
+  else
+    echo "FAIL  $name"
+    failed=1
+  fi
+}
+
+for input in "${inputs[@]}"; do
+  in="$tmp/$input"
+  for flags in "" -w -a -m -b -x; do
+    "$enc1" $flags "$in" "$tmp/c1" > /dev/null
+    (cat "$tmp/c1" | "$enc1" -d -c > "$tmp/d1") || true
+    check "arith1 ${flags:-classic} $input, decoded from a pipe" "$in" "$tmp/d1"
+  done
+  for flags in "" -w -a -m -b; do
+    (cat "$in" | "$enc1" $flags -c | "$enc1" -d -c > "$tmp/d1") || true
+    check "arith1 ${flags:-classic} $input, stream format" "$in" "$tmp/d1"
+  done
+
+  for flags in "" "-j 2"; do
+    "$enc2" c $flags "$in" "$tmp/c2" > /dev/null
+    (cat "$tmp/c2" | "$enc2" d -c > "$tmp/d2") || true
+    check "arith2 ${flags:-whole-file} $input, decoded from a pipe" "$in" "$tmp/d2"
+    "$enc2" d "$tmp/c2" "$tmp/d2"
+    check "arith2 ${flags:-whole-file} $input, decoded by path" "$in" "$tmp/d2"
+  done
+  (cat "$in" | "$enc2" c -c | "$enc2" d -c > "$tmp/d2") || true
+  check "arith2 stream $input" "$in" "$tmp/d2"
+done
+
+exit $failed
@@ -0,0 +1,17 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Builds and runs src/check/compressed_streambuf_check.cpp: round trips
+# through tai::compressing_streambuf / decompressing_streambuf, which cover
+# encoder 1's writeStreamHeader, readFrame and skipFrame. Exits 1 if any
+# check fails.
+#   ./scripts/check_streambuf.sh
+
+script_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+root_dir="$(cd "$script_dir/.." && pwd)"
+
+tmp="$(mktemp -d)"
+trap 'rm -rf "$tmp"' EXIT
+
+g++ -std=c++17 -O2 -pthread -o "$tmp/check" "$root_dir/src/check/compressed_streambuf_check.cpp"
+"$tmp/check"
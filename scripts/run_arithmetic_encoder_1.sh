@@ -32,11 +32,11 @@ if [[ ! -f "$input" ]]; then
   exit 1
 fi
 
-# Build binary if missing or older than source
+# Build binary if missing or older than any source it compiles in
 bin="$root_dir/arithmetic_encoder_1"
 src="$root_dir/src/coder/arithmetic_encoder_1.cpp"
-if [[ ! -x "$bin" || "$src" -nt "$bin" ]]; then
-  g++ -std=c++17 -O3 -o "$bin" "$src"
+if [[ ! -x "$bin" ]] || [[ -n "$(find "$root_dir/src/coder" "$root_dir/src/common" "$root_dir/src/transform" -newer "$bin" -name '*.[ch]*' -print -quit)" ]]; then
+  g++ -std=c++17 -O3 -pthread -o "$bin" "$src"
 fi
 
 if [[ "$mode" == "decompress" ]]; then
@@ -0,0 +1,29 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# In-process benchmark harness for our codecs (see src/bench/benchmark.cpp
+# or run with -h for options). Arguments are passed through, e.g.:
+#   ./scripts/run_benchmark.sh -c -r 5 -j results/bench.json
+#   ./scripts/run_benchmark.sh -c -r 5 -b results/bench.json -t 5
+#   ./scripts/run_benchmark.sh -f A -L -n 1000 -j results/latency.json
+
+script_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+root_dir="$(cd "$script_dir/.." && pwd)"
+
+# Build binary if missing or older than any source it compiles in
+bin="$root_dir/benchmark"
+src="$root_dir/src/bench/benchmark.cpp"
+if [[ ! -x "$bin" ]] || [[ -n "$(find "$root_dir/src" -newer "$bin" -name '*.[ch]*' -print -quit)" ]]; then
+  g++ -std=c++17 -O3 -pthread -o "$bin" "$src"
+fi
+
+# The latency mode (-L) also spawns the command-line tools from the root
+for tool in arithmetic_encoder_1 arithmetic_encoder_2; do
+  tool_bin="$root_dir/$tool"
+  if [[ ! -x "$tool_bin" ]] || [[ -n "$(find "$root_dir/src/coder" "$root_dir/src/common" "$root_dir/src/transform" -newer "$tool_bin" -name '*.[ch]*' -print -quit)" ]]; then
+    g++ -std=c++17 -O3 -pthread -o "$tool_bin" "$root_dir/src/coder/$tool.cpp"
+  fi
+done
+
+cd "$root_dir"
+exec "$bin" "$@"
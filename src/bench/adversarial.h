@@ -0,0 +1,109 @@
+#ifndef TAI_BENCH_ADVERSARIAL_H
+#define TAI_BENCH_ADVERSARIAL_H
+
+// Pathological inputs for the benchmark's -A: data that drives the coders
+// into their slow paths, so worst-case throughput is tracked next to the
+// corpus average. Every case is generated from a fixed seed, so a size gives
+// the same bytes on every machine and run.
+//
+//   alternating   two symbols in turn; every symbol changes the model state
+//   straddle      runs of the symbol whose interval contains the midpoint,
+//                 so the coder only rescales by E3 and bits_to_follow grows
+//                 with the run
+//   uniform       random bytes: nothing to model, the full 256-symbol table
+//   top-bytes     random bytes from 0xF0-0xFF: a linear decode search walks
+//                 almost the whole alphabet for every symbol
+//   short-runs    short runs of random symbols: fast adaptation wins, and
+//                 with a large increment the model rescales every few symbols
+//   sawtooth      0, 1, ..., 255 repeated: every cumulative-frequency update
+//                 starts at a different symbol
+//   single        one symbol repeated: the degenerate one-entry model
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace tai {
+namespace bench {
+
+struct AdversarialCase {
+    const char* name;
+    void (*generate)(std::vector<unsigned char>& out, size_t bytes, std::mt19937_64& rng);
+};
+
+namespace adversarial_detail {
+
+inline void alternating(std::vector<unsigned char>& out, size_t bytes, std::mt19937_64&) {
+    for (size_t i = 0; i < bytes; i++) out.push_back(i & 1 ? 0xAA : 0x55);
+}
+
+// 'a' and 'c' take 45% each and 'b' the 10% around the midpoint; the 'b's
+// come in runs of 4 KiB, the rest alternates.
+inline void straddle(std::vector<unsigned char>& out, size_t bytes, std::mt19937_64&) {
+    const size_t RUN = 4096;
+    for (size_t i = 0; i < bytes; i++) {
+        size_t block = i / RUN;
+        out.push_back(block % 10 == 9 ? 'b' : (i & 1 ? 'c' : 'a'));
+    }
+}
+
+inline void uniform(std::vector<unsigned char>& out, size_t bytes, std::mt19937_64& rng) {
+    for (size_t i = 0; i < bytes; i++) out.push_back(static_cast<unsigned char>(rng()));
+}
+
+inline void topBytes(std::vector<unsigned char>& out, size_t bytes, std::mt19937_64& rng) {
+    for (size_t i = 0; i < bytes; i++) out.push_back(static_cast<unsigned char>(0xF0 | (rng() & 15)));
+}
+
+inline void shortRuns(std::vector<unsigned char>& out, size_t bytes, std::mt19937_64& rng) {
+    while (out.size() < bytes) {
+        unsigned char value = static_cast<unsigned char>(rng());
+        size_t run = 16 + rng() % 49;
+        for (size_t i = 0; i < run && out.size() < bytes; i++) out.push_back(value);
+    }
+}
+
+inline void sawtooth(std::vector<unsigned char>& out, size_t bytes, std::mt19937_64&) {
+    for (size_t i = 0; i < bytes; i++) out.push_back(static_cast<unsigned char>(i));
+}
+
+inline void single(std::vector<unsigned char>& out, size_t bytes, std::mt19937_64&) {
+    out.assign(bytes, 'x');
+}
+
+} // namespace adversarial_detail
+
+inline const std::vector<AdversarialCase>& adversarialCases() {
+    static const std::vector<AdversarialCase> cases = {
+        {"alternating", adversarial_detail::alternating},
+        {"straddle", adversarial_detail::straddle},
+        {"uniform", adversarial_detail::uniform},
+        {"top-bytes", adversarial_detail::topBytes},
+        {"short-runs", adversarial_detail::shortRuns},
+        {"sawtooth", adversarial_detail::sawtooth},
+        {"single", adversarial_detail::single},
+    };
+    return cases;
+}
+
+inline std::vector<unsigned char> generateCase(const AdversarialCase& c, size_t bytes) {
+    std::mt19937_64 rng(0x7A1ADBE5u);
+    std::vector<unsigned char> out;
+    out.reserve(bytes);
+    c.generate(out, bytes, rng);
+    return out;
+}
+
+inline void writeCase(const AdversarialCase& c, const std::string& path, size_t bytes) {
+    std::vector<unsigned char> data = generateCase(c, bytes);
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+} // namespace bench
+} // namespace tai
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef TAI_BENCH_BENCH_UTIL_H
+#define TAI_BENCH_BENCH_UTIL_H
+
+// Timing, robust statistics, memory and temp-file helpers shared by the
+// benchmark modes.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+
+namespace tai {
+namespace bench {
+
+struct Summary {
+    double median = 0.0;
+    double mad = 0.0;    // median absolute deviation
+    double min = 0.0;
+    double max = 0.0;
+};
+
+inline double medianOf(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+inline Summary summarize(const std::vector<double>& samples) {
+    Summary s;
+    if (samples.empty()) return s;
+    s.median = medianOf(samples);
+    std::vector<double> dev;
+    dev.reserve(samples.size());
+    for (double x : samples) dev.push_back(std::fabs(x - s.median));
+    s.mad = medianOf(dev);
+    s.min = *std::min_element(samples.begin(), samples.end());
+    s.max = *std::max_element(samples.begin(), samples.end());
+    return s;
+}
+
+// Seconds of wall time spent in fn().
+template <typename Fn>
+double timeIt(Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// MB here is 2^20 bytes, as in benchmark.sh and benchmarks.md.
+inline double toMB(long long bytes) {
+    return bytes / 1048576.0;
+}
+
+inline double mbPerSecond(long long bytes, double seconds) {
+    return seconds > 0 ? toMB(bytes) / seconds : 0.0;
+}
+
+// Resets the kernel's peak-RSS watermark (Linux >= 4.0) so peakRssKb()
+// reports the peak of the work that follows rather than of the whole process.
+inline void resetPeakRss() {
+    std::ofstream clear("/proc/self/clear_refs");
+    if (clear) clear << "5";
+}
+
+inline long long peakRssKb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::atoll(line.c_str() + 6);
+        }
+    }
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+inline bool sameContents(const std::string& a, const std::string& b) {
+    std::ifstream fa(a, std::ios::binary), fb(b, std::ios::binary);
+    if (!fa || !fb) return false;
+    std::vector<char> ba(1 << 16), bb(1 << 16);
+    for (;;) {
+        fa.read(ba.data(), static_cast<std::streamsize>(ba.size()));
+        fb.read(bb.data(), static_cast<std::streamsize>(bb.size()));
+        if (fa.gcount() != fb.gcount()) return false;
+        if (!std::equal(ba.begin(), ba.begin() + fa.gcount(), bb.begin())) return false;
+        if (fa.gcount() == 0) return true;
+    }
+}
+
+// Private scratch directory, removed with everything in it on destruction.
+class TempDir {
+private:
+    std::filesystem::path dir;
+
+public:
+    TempDir() {
+        dir = std::filesystem::temp_directory_path() /
+              ("tai_bench_" + std::to_string(static_cast<long long>(getpid())));
+        std::filesystem::create_directories(dir);
+    }
+    ~TempDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    std::string path(const std::string& name) const {
+        return (dir / name).string();
+    }
+};
+
+} // namespace bench
+} // namespace tai
+
+#endif
@@ -0,0 +1,788 @@
+// benchmark — in-process benchmark harness for our codecs.
+//
+// Runs every registered codec over the corpus RUNS times without forking a
+// shell per timing, and reports median / MAD wall times, MB/s, bits/byte and
+// peak RSS in the same table layout as benchmarks.md. Results can be written
+// as JSON and compared against a stored baseline; a throughput regression
+// beyond the threshold makes the run fail (exit status 2). With -p one more
+// compress and decompress per codec runs under hardware counters
+// (perf_counters.h), reported per input byte for the whole run and for each
+// coder phase (common/phase.h). -m N replaces the single-job tables with a
+// scaling run of 1, 2, 4, ... N concurrent jobs per codec (scaling.h), and
+// -L with per-call latency percentiles of small payloads through the
+// in-process API and the command-line tools (latency.h). -A benchmarks
+// generated pathological inputs instead of the corpus (adversarial.h) and,
+// with -F, fails the run if a case falls below its MB/s floor.
+//
+// Usage: benchmark [OPTIONS]
+//   -d DIR        Data directory (default: data)
+//   -f FILES      Comma-separated file names (default: A,B,C,D,E,F,G,H)
+//   -c            Benchmark the concatenation of FILES instead of each file
+//   -k CODECS     Comma-separated codec names (default: all registered)
+//   -r RUNS       Timing runs per codec and direction (default: 3)
+//   -j FILE       Write results as JSON
+//   -b FILE       Compare against a baseline JSON written by -j
+//   -t PERCENT    Allowed throughput regression vs the baseline (default: 5)
+//   -p            Hardware counters per phase (skipped if perf_event_open is denied)
+//   -m JOBS       Multi-tenant scaling: up to JOBS concurrent jobs per codec
+//   -L            Small-record latency: p50/p99/p99.9 per payload size
+//   -s SIZES      Latency payload sizes, K suffix allowed (default: 256,1K,4K,16K,64K)
+//   -n ITER       Latency iterations per size, codec and surface (default: 1000)
+//   -B DIR        Directory of the command-line tools for -L (default: .)
+//   -A            Benchmark the adversarial cases (1 MiB each) instead of FILES
+//   -F FILE       MB/s floors for -A; exit 2 if a case is slower
+//   -G DIR        Write the adversarial cases to DIR and exit
+//   -l            List registered codecs and exit
+//   -q            Quiet — only print the tables
+//   -h            Show this help
+
+#include "adversarial.h"
+#include "bench_util.h"
+#include "codecs.h"
+#include "json.h"
+#include "latency.h"
+#include "perf_counters.h"
+#include "scaling.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string data_dir = "data";
+    std::vector<std::string> files = {"A", "B", "C", "D", "E", "F", "G", "H"};
+    bool concat = false;
+    std::vector<std::string> codecs;
+    int runs = 3;
+    std::string json_out;
+    std::string baseline;
+    double threshold_pct = 5.0;
+    bool perf = false;
+    int max_jobs = 0;       // -m: scaling mode
+    bool latency = false;   // -L: latency mode
+    std::vector<size_t> sizes = {256, 1024, 4096, 16384, 65536};
+    int iterations = 1000;
+    std::string bin_dir = ".";
+    bool adversarial = false;   // -A
+    std::string floors;
+    std::string generate_dir;
+    bool quiet = false;
+};
+
+const size_t ADVERSARIAL_BYTES = size_t(1) << 20;
+
+struct LatencyResult {
+    std::string input;
+    std::string codec;
+    tai::bench::LatencyPoint point;
+};
+
+struct ScalingResult {
+    std::string input;
+    std::string codec;
+    std::vector<tai::bench::ScalingPoint> points;
+};
+
+// Counter totals of one direction: the whole run, then each phase entered.
+struct CounterRow {
+    std::string phase;
+    uint64_t calls = 0;
+    tai::bench::CounterValues values;
+};
+
+struct Result {
+    std::string input;
+    std::string codec;
+    long long original_bytes = 0;
+    long long compressed_bytes = 0;
+    tai::bench::Summary comp;
+    tai::bench::Summary decomp;
+    long long peak_rss_kb = 0;
+    bool lossless = false;
+    std::vector<CounterRow> comp_counters, decomp_counters;
+
+    double compMBps() const { return tai::bench::mbPerSecond(original_bytes, comp.median); }
+    double decompMBps() const { return tai::bench::mbPerSecond(original_bytes, decomp.median); }
+    double bitsPerByte() const {
+        return original_bytes > 0 ? compressed_bytes * 8.0 / original_bytes : 0.0;
+    }
+};
+
+void usage() {
+    std::cerr <<
+        "Usage: benchmark [-d DIR] [-f A,B,...] [-c] [-k CODECS] [-r RUNS]\n"
+        "                 [-j OUT.json] [-b BASELINE.json] [-t PERCENT] [-p] [-m JOBS]\n"
+        "                 [-L [-s SIZES] [-n ITER] [-B BINDIR]] [-A [-F FLOORS.json]] [-G DIR]\n"
+        "                 [-l] [-q]\n";
+}
+
+// Runs fn once under counters and returns the rows for it.
+template <typename Fn>
+std::vector<CounterRow> countOne(const tai::bench::PerfCounters& counters, Fn&& fn) {
+    tai::bench::PhaseProfiler profiler(counters);
+    tai::bench::PerfCounters::Snapshot before, after;
+    {
+        tai::bench::ScopedPhaseHook hook(&profiler);
+        before = counters.snapshot();
+        fn();
+        after = counters.snapshot();
+    }
+    std::vector<CounterRow> rows;
+    rows.push_back({"total", 1, tai::bench::PerfCounters::delta(before, after)});
+    for (int i = 0; i < static_cast<int>(tai::Phase::COUNT); i++) {
+        tai::Phase phase = static_cast<tai::Phase>(i);
+        const auto& counts = profiler.counts(phase);
+        if (counts.calls > 0) rows.push_back({tai::phaseName(phase), counts.calls, counts.total()});
+    }
+    return rows;
+}
+
+Result benchOne(const tai::Codec& codec, const std::string& label, const std::string& input,
+                const tai::bench::TempDir& tmp, int runs, bool quiet,
+                const tai::bench::PerfCounters* counters) {
+    Result r;
+    r.input = label;
+    r.codec = codec.name;
+    r.original_bytes = static_cast<long long>(std::filesystem::file_size(input));
+    std::string comp_path = tmp.path("comp");
+    std::string decomp_path = tmp.path("decomp");
+
+    if (!quiet) std::cerr << "[bench]   -> " << codec.name << " ..." << std::endl;
+    tai::bench::resetPeakRss();
+    std::vector<double> tc, td;
+    for (int i = 0; i < runs; i++) {
+        tc.push_back(tai::bench::timeIt([&] { codec.compress(input, comp_path); }));
+    }
+    r.compressed_bytes = static_cast<long long>(std::filesystem::file_size(comp_path));
+    for (int i = 0; i < runs; i++) {
+        td.push_back(tai::bench::timeIt([&] { codec.decompress(comp_path, decomp_path); }));
+    }
+    r.peak_rss_kb = tai::bench::peakRssKb();
+    r.comp = tai::bench::summarize(tc);
+    r.decomp = tai::bench::summarize(td);
+    r.lossless = tai::bench::sameContents(input, decomp_path);
+    // Separate runs, so the counter reads stay out of the timings.
+    if (counters) {
+        r.comp_counters = countOne(*counters, [&] { codec.compress(input, comp_path); });
+        r.decomp_counters = countOne(*counters, [&] { codec.decompress(comp_path, decomp_path); });
+    }
+    std::filesystem::remove(comp_path);
+    std::filesystem::remove(decomp_path);
+    return r;
+}
+
+// Width of the Compressor column in the padded tables: the longest
+// registered codec name, so every row lines up.
+int codecWidth() {
+    static const int width = [] {
+        size_t w = std::strlen("Compressor");
+        for (const tai::Codec& codec : tai::registeredCodecs()) w = std::max(w, codec.name.size());
+        return static_cast<int>(w);
+    }();
+    return width;
+}
+
+// "| Compressor |" and its "|:---|" rule, padded to codecWidth().
+std::string codecHeader() {
+    return "| " + std::string("Compressor") + std::string(codecWidth() - std::strlen("Compressor"), ' ') + " |";
+}
+
+std::string codecRule() {
+    return "|:" + std::string(codecWidth() + 1, '-') + "|";
+}
+
+void printTables(const std::string& label, std::vector<Result> rows) {
+    std::stable_sort(rows.begin(), rows.end(), [](const Result& a, const Result& b) {
+        return a.compressed_bytes < b.compressed_bytes;
+    });
+    std::cout << "\n## Benchmark — " << label << "\n\n";
+    std::cout << "| Rank " << codecHeader() << " Original (MB) | Compressed (MB) | Ratio  | bits/byte "
+                 "| t_comp (s) | t_decomp (s) | t_total (s) | Lossless |\n";
+    std::cout << "|-----:" << codecRule() << "-------------:|----------------:|-------:|----------:"
+                 "|-----------:|-------------:|------------:|:--------:|\n";
+    int rank = 1;
+    for (const Result& r : rows) {
+        char ratio[16];
+        std::snprintf(ratio, sizeof(ratio), "%.1f%%",
+                      r.original_bytes > 0 ? 100.0 * r.compressed_bytes / r.original_bytes : 0.0);
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "| %4d | %-*s | %13.2f | %15.2f | %6s | %9.3f | %10.3f | %12.3f | %11.3f | %-8s |\n",
+                      rank++, codecWidth(), r.codec.c_str(), tai::bench::toMB(r.original_bytes),
+                      tai::bench::toMB(r.compressed_bytes), ratio, r.bitsPerByte(),
+                      r.comp.median, r.decomp.median, r.comp.median + r.decomp.median,
+                      r.lossless ? "  YES" : "  NO");
+        std::cout << line;
+    }
+    std::cout << "\n" << codecHeader() << " comp (MB/s) | decomp (MB/s) | t_comp MAD (s) | t_decomp MAD (s) "
+                 "| peak RSS (MB) |\n";
+    std::cout << codecRule() << "------------:|--------------:|---------------:|-----------------:"
+                 "|--------------:|\n";
+    for (const Result& r : rows) {
+        char line[256];
+        std::snprintf(line, sizeof(line), "| %-*s | %11.2f | %13.2f | %14.4f | %16.4f | %13.1f |\n",
+                      codecWidth(), r.codec.c_str(), r.compMBps(), r.decompMBps(), r.comp.mad, r.decomp.mad,
+                      r.peak_rss_kb / 1024.0);
+        std::cout << line;
+    }
+}
+
+// Per input byte; n/a for counters the machine did not open.
+void printCounters(const std::string& label, const std::vector<Result>& rows,
+                   const tai::bench::PerfCounters& counters) {
+    using tai::bench::Counter;
+    std::cout << "\n## Hardware counters — " << label << " (per input byte)\n\n";
+    std::cout << "| Compressor | Dir | Phase | calls | cycles | instr | IPC | br-miss | L1d-miss "
+                 "| LLC-miss | dTLB-miss | ns |\n";
+    std::cout << "|:-----------|:----|:------|------:|-------:|------:|----:|--------:|---------:"
+                 "|---------:|----------:|---:|\n";
+    auto cell = [&](const CounterRow& row, Counter c, double bytes) {
+        if (!counters.has(c)) return std::string("n/a");
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.4g", bytes > 0 ? row.values[c] / bytes : 0.0);
+        return std::string(buf);
+    };
+    for (const Result& r : rows) {
+        for (int dir = 0; dir < 2; dir++) {
+            for (const CounterRow& row : dir ? r.decomp_counters : r.comp_counters) {
+                double bytes = static_cast<double>(r.original_bytes);
+                std::string ipc = "n/a";
+                if (counters.has(Counter::Cycles) && counters.has(Counter::Instructions) &&
+                    row.values[Counter::Cycles] > 0) {
+                    char buf[32];
+                    std::snprintf(buf, sizeof(buf), "%.2f",
+                                  row.values[Counter::Instructions] / row.values[Counter::Cycles]);
+                    ipc = buf;
+                }
+                std::cout << "| " << r.codec << " | " << (dir ? "decomp" : "comp") << " | " << row.phase
+                          << " | " << row.calls << " | " << cell(row, Counter::Cycles, bytes)
+                          << " | " << cell(row, Counter::Instructions, bytes) << " | " << ipc
+                          << " | " << cell(row, Counter::BranchMisses, bytes)
+                          << " | " << cell(row, Counter::L1dMisses, bytes)
+                          << " | " << cell(row, Counter::LlcMisses, bytes)
+                          << " | " << cell(row, Counter::DtlbMisses, bytes)
+                          << " | " << cell(row, Counter::TaskClock, bytes) << " |\n";
+            }
+        }
+    }
+}
+
+// Slowdown is a job's median time over the single-job median.
+void printScaling(const std::string& label, const std::vector<ScalingResult>& results) {
+    std::cout << "\n## Scaling — " << label << "\n\n";
+    std::cout << codecHeader() << " Jobs | comp agg (MB/s) | decomp agg (MB/s) | comp slowdown "
+                 "| decomp slowdown | peak RSS total (MB) | peak RSS/job (MB) | Lossless |\n";
+    std::cout << codecRule() << "-----:|----------------:|------------------:|--------------:"
+                 "|----------------:|--------------------:|------------------:|:--------:|\n";
+    for (const ScalingResult& r : results) {
+        const tai::bench::ScalingPoint& one = r.points.front();
+        for (const tai::bench::ScalingPoint& p : r.points) {
+            char line[256];
+            std::snprintf(line, sizeof(line),
+                          "| %-*s | %4d | %15.2f | %17.2f | %12.2fx | %14.2fx | %19.1f | %17.1f | %-8s |\n",
+                          codecWidth(), r.codec.c_str(), p.jobs, p.comp_mbps, p.decomp_mbps,
+                          one.comp_job > 0 ? p.comp_job / one.comp_job : 0.0,
+                          one.decomp_job > 0 ? p.decomp_job / one.decomp_job : 0.0,
+                          p.rss_total_kb / 1024.0, p.rss_job_kb / 1024.0, p.lossless ? "  YES" : "  NO");
+            std::cout << line;
+        }
+    }
+}
+
+// Microseconds per call.
+void printLatency(const std::string& label, const std::vector<LatencyResult>& results) {
+    std::cout << "\n## Latency — " << label << " (µs per call)\n\n";
+    std::cout << codecHeader() << " Surface | Payload (B) | Compressed (B) | comp p50 | comp p99 | comp p99.9 "
+                 "| decomp p50 | decomp p99 | decomp p99.9 | Lossless |\n";
+    std::cout << codecRule() << ":--------|------------:|---------------:|---------:|---------:|-----------:"
+                 "|-----------:|-----------:|-------------:|:--------:|\n";
+    for (const LatencyResult& r : results) {
+        const tai::bench::LatencyPoint& p = r.point;
+        char line[256];
+        std::snprintf(line, sizeof(line),
+                      "| %-*s | %-7s | %11zu | %14lld | %8.1f | %8.1f | %10.1f | %10.1f | %10.1f | %12.1f | %-8s |\n",
+                      codecWidth(), r.codec.c_str(), p.surface.c_str(), p.bytes, p.compressed_bytes,
+                      p.comp.p50 * 1e6, p.comp.p99 * 1e6, p.comp.p999 * 1e6,
+                      p.decomp.p50 * 1e6, p.decomp.p99 * 1e6, p.decomp.p999 * 1e6,
+                      p.lossless ? "  YES" : "  NO");
+        std::cout << line;
+    }
+}
+
+tai::json::Value latencyJson(const std::vector<LatencyResult>& results) {
+    tai::json::Value list = tai::json::Value::makeArray();
+    for (const LatencyResult& r : results) {
+        const tai::bench::LatencyPoint& p = r.point;
+        tai::json::Value e = tai::json::Value::makeObject();
+        e["input"] = r.input;
+        e["codec"] = r.codec;
+        e["surface"] = p.surface;
+        e["bytes"] = static_cast<double>(p.bytes);
+        e["compressed_bytes"] = p.compressed_bytes;
+        e["iterations"] = p.iterations;
+        e["comp_p50"] = p.comp.p50;
+        e["comp_p99"] = p.comp.p99;
+        e["comp_p999"] = p.comp.p999;
+        e["comp_max"] = p.comp.max;
+        e["decomp_p50"] = p.decomp.p50;
+        e["decomp_p99"] = p.decomp.p99;
+        e["decomp_p999"] = p.decomp.p999;
+        e["decomp_max"] = p.decomp.max;
+        e["lossless"] = p.lossless;
+        list.array.push_back(e);
+    }
+    return list;
+}
+
+// Latency regressions: p50 or p99 slower than the baseline by more than the
+// threshold. p99.9 is reported but not compared; one scheduler hiccup moves it.
+int compareLatencyBaseline(const std::vector<LatencyResult>& results, const tai::json::Value& baseline,
+                           double threshold_pct) {
+    const tai::json::Value* list = baseline.find("latency");
+    if (list == nullptr || list->type != tai::json::Value::Type::Array) {
+        throw std::runtime_error("baseline has no latency array");
+    }
+    int regressions = 0;
+    std::cout << "\n## Latency baseline comparison (threshold " << threshold_pct << "%)\n\n";
+    std::cout << "| Input | Compressor | Surface | Payload (B) | comp p50 | delta | comp p99 | delta "
+                 "| decomp p50 | delta | decomp p99 | delta | status |\n";
+    std::cout << "|:------|:-----------|:--------|------------:|---------:|------:|---------:|------:"
+                 "|-----------:|------:|-----------:|------:|:------:|\n";
+    for (const LatencyResult& r : results) {
+        const tai::bench::LatencyPoint& p = r.point;
+        const tai::json::Value* base = nullptr;
+        for (const auto& e : list->array) {
+            if (e.stringOr("input", "") == r.input && e.stringOr("codec", "") == r.codec &&
+                e.stringOr("surface", "") == p.surface && e.numberOr("bytes", 0) == static_cast<double>(p.bytes)) {
+                base = &e;
+            }
+        }
+        if (base == nullptr) continue;
+        auto delta = [&](const char* key, double now) {
+            double was = base->numberOr(key, 0);
+            return was > 0 ? 100.0 * (now - was) / was : 0.0;
+        };
+        double dc50 = delta("comp_p50", p.comp.p50), dc99 = delta("comp_p99", p.comp.p99);
+        double dd50 = delta("decomp_p50", p.decomp.p50), dd99 = delta("decomp_p99", p.decomp.p99);
+        bool bad = dc50 > threshold_pct || dc99 > threshold_pct || dd50 > threshold_pct ||
+                   dd99 > threshold_pct || !p.lossless;
+        regressions += bad;
+        char line[320];
+        std::snprintf(line, sizeof(line),
+                      "| %s | %s | %s | %zu | %.1f | %+.1f%% | %.1f | %+.1f%% | %.1f | %+.1f%% | %.1f | %+.1f%% | %s |\n",
+                      r.input.c_str(), r.codec.c_str(), p.surface.c_str(), p.bytes,
+                      p.comp.p50 * 1e6, dc50, p.comp.p99 * 1e6, dc99,
+                      p.decomp.p50 * 1e6, dd50, p.decomp.p99 * 1e6, dd99, bad ? "FAIL" : "ok");
+        std::cout << line;
+    }
+    return regressions;
+}
+
+tai::json::Value scalingJson(const std::vector<ScalingResult>& results) {
+    tai::json::Value list = tai::json::Value::makeArray();
+    for (const ScalingResult& r : results) {
+        for (const tai::bench::ScalingPoint& p : r.points) {
+            tai::json::Value e = tai::json::Value::makeObject();
+            e["input"] = r.input;
+            e["codec"] = r.codec;
+            e["jobs"] = p.jobs;
+            e["comp_mbps"] = p.comp_mbps;
+            e["decomp_mbps"] = p.decomp_mbps;
+            e["t_comp_job_median"] = p.comp_job;
+            e["t_decomp_job_median"] = p.decomp_job;
+            e["peak_rss_total_kb"] = p.rss_total_kb;
+            e["peak_rss_job_kb"] = p.rss_job_kb;
+            e["lossless"] = p.lossless;
+            list.array.push_back(e);
+        }
+    }
+    return list;
+}
+
+tai::json::Value countersJson(const std::vector<CounterRow>& rows, long long bytes,
+                              const tai::bench::PerfCounters& counters) {
+    tai::json::Value out = tai::json::Value::makeObject();
+    for (const CounterRow& row : rows) {
+        tai::json::Value e = tai::json::Value::makeObject();
+        e["calls"] = static_cast<double>(row.calls);
+        for (int i = 0; i < tai::bench::COUNTERS; i++) {
+            auto c = static_cast<tai::bench::Counter>(i);
+            if (counters.has(c)) {
+                e[std::string(tai::bench::counterName(c)) + "_per_byte"] =
+                    bytes > 0 ? row.values[c] / static_cast<double>(bytes) : 0.0;
+            }
+        }
+        out[row.phase] = e;
+    }
+    return out;
+}
+
+tai::json::Value toJson(const Options& opt, const std::vector<Result>& results,
+                        const tai::bench::PerfCounters* counters) {
+    tai::json::Value root = tai::json::Value::makeObject();
+    root["runs"] = opt.runs;
+    root["isa"] = tai::isaName(tai::activeIsa());
+    tai::json::Value list = tai::json::Value::makeArray();
+    for (const Result& r : results) {
+        tai::json::Value e = tai::json::Value::makeObject();
+        e["input"] = r.input;
+        e["codec"] = r.codec;
+        e["original_bytes"] = r.original_bytes;
+        e["compressed_bytes"] = r.compressed_bytes;
+        e["bits_per_byte"] = r.bitsPerByte();
+        e["t_comp_median"] = r.comp.median;
+        e["t_comp_mad"] = r.comp.mad;
+        e["t_decomp_median"] = r.decomp.median;
+        e["t_decomp_mad"] = r.decomp.mad;
+        e["comp_mbps"] = r.compMBps();
+        e["decomp_mbps"] = r.decompMBps();
+        e["peak_rss_kb"] = r.peak_rss_kb;
+        e["lossless"] = r.lossless;
+        if (counters && !r.comp_counters.empty()) {
+            tai::json::Value c = tai::json::Value::makeObject();
+            c["compress"] = countersJson(r.comp_counters, r.original_bytes, *counters);
+            c["decompress"] = countersJson(r.decomp_counters, r.original_bytes, *counters);
+            e["counters"] = c;
+        }
+        list.array.push_back(e);
+    }
+    root["results"] = list;
+    return root;
+}
+
+// Returns the number of regressions; also flags ratio and losslessness changes.
+int compareBaseline(const std::vector<Result>& results, const tai::json::Value& baseline,
+                    double threshold_pct) {
+    const tai::json::Value* list = baseline.find("results");
+    if (list == nullptr || list->type != tai::json::Value::Type::Array) {
+        throw std::runtime_error("baseline has no results array");
+    }
+    int regressions = 0;
+    std::cout << "\n## Baseline comparison (threshold " << threshold_pct << "%)\n\n";
+    std::cout << "| Input | Compressor | comp (MB/s) | base | delta | decomp (MB/s) | base | delta | status |\n";
+    std::cout << "|:------|:-----------|------------:|-----:|------:|--------------:|-----:|------:|:------:|\n";
+    for (const Result& r : results) {
+        const tai::json::Value* base = nullptr;
+        for (const auto& e : list->array) {
+            if (e.stringOr("input", "") == r.input && e.stringOr("codec", "") == r.codec) {
+                base = &e;
+            }
+        }
+        if (base == nullptr) continue;
+        double bc = base->numberOr("comp_mbps", 0), bd = base->numberOr("decomp_mbps", 0);
+        double dc = bc > 0 ? 100.0 * (r.compMBps() - bc) / bc : 0;
+        double dd = bd > 0 ? 100.0 * (r.decompMBps() - bd) / bd : 0;
+        bool bad = dc < -threshold_pct || dd < -threshold_pct || !r.lossless;
+        if (base->numberOr("compressed_bytes", 0) != 0 &&
+            r.compressed_bytes > base->numberOr("compressed_bytes", 0) * (1 + threshold_pct / 100)) {
+            bad = true;
+        }
+        regressions += bad;
+        char line[256];
+        std::snprintf(line, sizeof(line),
+                      "| %s | %s | %.2f | %.2f | %+.1f%% | %.2f | %.2f | %+.1f%% | %s |\n",
+                      r.input.c_str(), r.codec.c_str(), r.compMBps(), bc, dc, r.decompMBps(), bd, dd,
+                      bad ? "FAIL" : "ok");
+        std::cout << line;
+    }
+    return regressions;
+}
+
+// Floors are {"floors": [{"case", "codec", "comp_mbps", "decomp_mbps"}]};
+// codecs without an entry are not checked. Returns the number of cases below
+// their floor.
+int checkFloors(const std::vector<Result>& results, const tai::json::Value& floors) {
+    const tai::json::Value* list = floors.find("floors");
+    if (list == nullptr || list->type != tai::json::Value::Type::Array) {
+        throw std::runtime_error("floors file has no floors array");
+    }
+    int violations = 0;
+    std::cout << "\n## Adversarial floors\n\n";
+    std::cout << "| Case | Compressor | comp (MB/s) | floor | decomp (MB/s) | floor | status |\n";
+    std::cout << "|:-----|:-----------|------------:|------:|--------------:|------:|:------:|\n";
+    for (const Result& r : results) {
+        const tai::json::Value* floor = nullptr;
+        for (const auto& e : list->array) {
+            if ("Case " + e.stringOr("case", "") == r.input && e.stringOr("codec", "") == r.codec) {
+                floor = &e;
+            }
+        }
+        if (floor == nullptr) continue;
+        double fc = floor->numberOr("comp_mbps", 0), fd = floor->numberOr("decomp_mbps", 0);
+        bool bad = r.compMBps() < fc || r.decompMBps() < fd || !r.lossless;
+        violations += bad;
+        char line[256];
+        std::snprintf(line, sizeof(line), "| %s | %s | %.2f | %.2f | %.2f | %.2f | %s |\n",
+                      r.input.c_str() + 5, r.codec.c_str(), r.compMBps(), fc, r.decompMBps(), fd,
+                      bad ? "FAIL" : "ok");
+        std::cout << line;
+    }
+    return violations;
+}
+
+std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+// "256,1K,64K" -> byte counts.
+std::vector<size_t> parseSizes(const std::string& s) {
+    std::vector<size_t> out;
+    for (const std::string& item : splitList(s)) {
+        char* end = nullptr;
+        unsigned long long n = std::strtoull(item.c_str(), &end, 10);
+        if (*end == 'K' || *end == 'k') {
+            n *= 1024;
+            end++;
+        }
+        if (n == 0 || *end != '\0') throw std::runtime_error("bad payload size: " + item);
+        out.push_back(static_cast<size_t>(n));
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    int c;
+    while ((c = getopt(argc, argv, "d:f:ck:r:j:b:t:pm:Ls:n:B:AF:G:lqh")) != -1) {
+        switch (c) {
+            case 'd': opt.data_dir = optarg; break;
+            case 'f': opt.files = splitList(optarg); break;
+            case 'c': opt.concat = true; break;
+            case 'k': opt.codecs = splitList(optarg); break;
+            case 'r': opt.runs = std::max(1, std::atoi(optarg)); break;
+            case 'j': opt.json_out = optarg; break;
+            case 'b': opt.baseline = optarg; break;
+            case 't': opt.threshold_pct = std::atof(optarg); break;
+            case 'p': opt.perf = true; break;
+            case 'm': opt.max_jobs = std::max(1, std::atoi(optarg)); break;
+            case 'L': opt.latency = true; break;
+            case 's':
+                try {
+                    opt.sizes = parseSizes(optarg);
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: " << e.what() << std::endl;
+                    return 1;
+                }
+                break;
+            case 'n': opt.iterations = std::max(1, std::atoi(optarg)); break;
+            case 'B': opt.bin_dir = optarg; break;
+            case 'A': opt.adversarial = true; break;
+            case 'F': opt.floors = optarg; break;
+            case 'G': opt.generate_dir = optarg; break;
+            case 'q': opt.quiet = true; break;
+            case 'l':
+                for (const auto& codec : tai::registeredCodecs()) std::cout << codec.name << "\n";
+                return 0;
+            case 'h': usage(); return 0;
+            default: usage(); return 1;
+        }
+    }
+
+    try {
+        std::vector<tai::Codec> codecs;
+        for (auto& codec : tai::registeredCodecs()) {
+            if (opt.codecs.empty() ||
+                std::find(opt.codecs.begin(), opt.codecs.end(), codec.name) != opt.codecs.end()) {
+                codecs.push_back(std::move(codec));
+            }
+        }
+        if (codecs.empty()) throw std::runtime_error("no codec selected (see -l)");
+
+        std::unique_ptr<tai::bench::PerfCounters> counters;
+        if (opt.perf) {
+            counters.reset(new tai::bench::PerfCounters());
+            if (!counters->available()) {
+                std::cerr << "[bench] hardware counters unavailable (" << counters->reason()
+                          << "); see /proc/sys/kernel/perf_event_paranoid. Running without -p."
+                          << std::endl;
+                counters.reset();
+            } else if (!counters->reason().empty() && !opt.quiet) {
+                std::cerr << "[bench] some counters unavailable, first: " << counters->reason()
+                          << std::endl;
+            }
+        }
+
+        if (!opt.generate_dir.empty()) {
+            std::filesystem::create_directories(opt.generate_dir);
+            for (const auto& c : tai::bench::adversarialCases()) {
+                tai::bench::writeCase(c, opt.generate_dir + "/" + c.name, ADVERSARIAL_BYTES);
+            }
+            return 0;
+        }
+
+        tai::bench::TempDir tmp;
+        std::vector<std::pair<std::string, std::string>> inputs;    // label, path
+        if (opt.adversarial) {
+            opt.files.clear();
+            opt.concat = false;
+            for (const auto& c : tai::bench::adversarialCases()) {
+                inputs.push_back({std::string("Case ") + c.name, tmp.path(c.name)});
+                tai::bench::writeCase(c, inputs.back().second, ADVERSARIAL_BYTES);
+            }
+        }
+        for (const auto& f : opt.files) {
+            std::string path = opt.data_dir + "/" + f;
+            if (!std::filesystem::is_regular_file(path)) throw std::runtime_error("File not found: " + path);
+            inputs.push_back({"File " + f, path});
+        }
+        if (opt.concat) {
+            std::string cat = tmp.path("concat");
+            std::ofstream out(cat, std::ios::binary);
+            std::string label = "Concatenated (";
+            for (size_t i = 0; i < inputs.size(); i++) {
+                std::ifstream in(inputs[i].second, std::ios::binary);
+                out << in.rdbuf();
+                label += (i ? "+" : "") + opt.files[i];
+            }
+            inputs = {{label + ")", cat}};
+        }
+
+        if (opt.max_jobs > 0) {
+            std::vector<ScalingResult> scaling;
+            for (const auto& [label, path] : inputs) {
+                if (!opt.quiet) std::cerr << "[bench] Scaling: " << label << std::endl;
+                std::vector<ScalingResult> rows;
+                for (const auto& codec : codecs) {
+                    if (!opt.quiet) std::cerr << "[bench]   -> " << codec.name << " ..." << std::endl;
+                    rows.push_back({label, codec.name,
+                                    tai::bench::runScaling(codec, path, tmp, opt.max_jobs, opt.runs)});
+                }
+                printScaling(label, rows);
+                scaling.insert(scaling.end(), rows.begin(), rows.end());
+            }
+            if (!opt.json_out.empty()) {
+                tai::json::Value root = tai::json::Value::makeObject();
+                root["runs"] = opt.runs;
+                root["isa"] = tai::isaName(tai::activeIsa());
+                root["scaling"] = scalingJson(scaling);
+                std::ofstream out(opt.json_out);
+                tai::json::write(out, root);
+                out << "\n";
+            }
+            bool lossless = std::all_of(scaling.begin(), scaling.end(), [](const ScalingResult& r) {
+                return std::all_of(r.points.begin(), r.points.end(),
+                                   [](const tai::bench::ScalingPoint& p) { return p.lossless; });
+            });
+            return lossless ? 0 : 2;
+        }
+
+        if (opt.latency) {
+            std::vector<LatencyResult> latency;
+            for (const auto& [label, path] : inputs) {
+                if (!opt.quiet) std::cerr << "[bench] Latency: " << label << std::endl;
+                std::vector<LatencyResult> rows;
+                for (size_t size : opt.sizes) {
+                    std::string payload = tmp.path("payload");
+                    tai::bench::writePayload(path, payload, size);
+                    for (const auto& codec : codecs) {
+                        if (!opt.quiet) {
+                            std::cerr << "[bench]   -> " << codec.name << " " << size << " B ..." << std::endl;
+                        }
+                        rows.push_back({label, codec.name,
+                                        tai::bench::measureApi(codec, payload, tmp, opt.iterations)});
+                        if (codec.cli_compress.empty()) continue;
+                        std::vector<std::string> cli_c = codec.cli_compress, cli_d = codec.cli_decompress;
+                        cli_c[0] = opt.bin_dir + "/" + cli_c[0];
+                        cli_d[0] = opt.bin_dir + "/" + cli_d[0];
+                        if (access(cli_c[0].c_str(), X_OK) != 0 || access(cli_d[0].c_str(), X_OK) != 0) {
+                            if (!opt.quiet) std::cerr << "[bench]      no " << cli_c[0] << ", cli skipped" << std::endl;
+                            continue;
+                        }
+                        rows.push_back({label, codec.name,
+                                        tai::bench::measureCli(cli_c, cli_d, payload, tmp, opt.iterations)});
+                    }
+                    std::filesystem::remove(payload);
+                }
+                printLatency(label, rows);
+                latency.insert(latency.end(), rows.begin(), rows.end());
+            }
+            if (!opt.json_out.empty()) {
+                tai::json::Value root = tai::json::Value::makeObject();
+                root["iterations"] = opt.iterations;
+                root["isa"] = tai::isaName(tai::activeIsa());
+                root["latency"] = latencyJson(latency);
+                std::ofstream out(opt.json_out);
+                tai::json::write(out, root);
+                out << "\n";
+            }
+            if (!opt.baseline.empty()) {
+                std::ifstream in(opt.baseline);
+                if (!in) throw std::runtime_error("Cannot open baseline: " + opt.baseline);
+                std::stringstream ss;
+                ss << in.rdbuf();
+                int regressions = compareLatencyBaseline(latency, tai::json::parse(ss.str()), opt.threshold_pct);
+                if (regressions > 0) {
+                    std::cout << "\n" << regressions << " regression(s) beyond " << opt.threshold_pct << "%\n";
+                    return 2;
+                }
+            }
+            bool lossless = std::all_of(latency.begin(), latency.end(),
+                                        [](const LatencyResult& r) { return r.point.lossless; });
+            return lossless ? 0 : 2;
+        }
+
+        std::vector<Result> all;
+        for (const auto& [label, path] : inputs) {
+            if (!opt.quiet) std::cerr << "[bench] Benchmarking: " << label << std::endl;
+            std::vector<Result> rows;
+            for (const auto& codec : codecs) {
+                rows.push_back(benchOne(codec, label, path, tmp, opt.runs, opt.quiet, counters.get()));
+            }
+            printTables(label, rows);
+            if (counters) printCounters(label, rows, *counters);
+            all.insert(all.end(), rows.begin(), rows.end());
+        }
+
+        if (!opt.json_out.empty()) {
+            std::ofstream out(opt.json_out);
+            tai::json::write(out, toJson(opt, all, counters.get()));
+            out << "\n";
+        }
+        if (!opt.baseline.empty()) {
+            std::ifstream in(opt.baseline);
+            if (!in) throw std::runtime_error("Cannot open baseline: " + opt.baseline);
+            std::stringstream ss;
+            ss << in.rdbuf();
+            int regressions = compareBaseline(all, tai::json::parse(ss.str()), opt.threshold_pct);
+            if (regressions > 0) {
+                std::cout << "\n" << regressions << " regression(s) beyond " << opt.threshold_pct << "%\n";
+                return 2;
+            }
+        }
+        if (opt.adversarial && !opt.floors.empty()) {
+            std::ifstream in(opt.floors);
+            if (!in) throw std::runtime_error("Cannot open floors: " + opt.floors);
+            std::stringstream ss;
+            ss << in.rdbuf();
+            int violations = checkFloors(all, tai::json::parse(ss.str()));
+            if (violations > 0) {
+                std::cout << "\n" << violations << " case(s) below their floor\n";
+                return 2;
+            }
+        }
+        bool lossless = std::all_of(all.begin(), all.end(), [](const Result& r) { return r.lossless; });
+        return lossless ? 0 : 2;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
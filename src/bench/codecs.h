@@ -0,0 +1,123 @@
+#ifndef TAI_BENCH_CODECS_H
+#define TAI_BENCH_CODECS_H
+
+// Codecs the benchmark harness runs in process, from the same headers the
+// command-line tools are built from, so the measured code is exactly what
+// the tools run. cli_compress and cli_decompress give the matching tool
+// invocation (binary name and options; paths are appended) for the latency
+// mode, empty where there is none.
+
+#include "../coder/arithmetic_encoder_1.h"
+#include "../coder/arithmetic_encoder_2.h"
+
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace tai {
+
+struct Codec {
+    std::string name;
+    // Both take (input path, output path), like the command-line tools.
+    std::function<void(const std::string&, const std::string&)> compress;
+    std::function<void(const std::string&, const std::string&)> decompress;
+    std::vector<std::string> cli_compress = {};
+    std::vector<std::string> cli_decompress = {};
+};
+
+inline std::vector<Codec> registeredCodecs() {
+    std::vector<Codec> codecs;
+    codecs.push_back({"arith1",
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.compress(in, out);
+        },
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.decompress(in, out);
+        },
+        {"arithmetic_encoder_1"},
+        {"arithmetic_encoder_1", "-d"}});
+    codecs.push_back({"arith1-stream",
+        [](const std::string& in, const std::string& out) {
+            std::ifstream infile(in, std::ios::binary);
+            std::ofstream outfile(out, std::ios::binary);
+            ArithmeticEncoder encoder;
+            encoder.compressStream(infile, outfile);
+        },
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.decompress(in, out);
+        }});
+    codecs.push_back({"arith1-wide",
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.compress(in, out, ArithmeticEncoder::Coder::Wide);
+        },
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.decompress(in, out);
+        },
+        {"arithmetic_encoder_1", "-w"},
+        {"arithmetic_encoder_1", "-d"}});
+    codecs.push_back({"arith1-adaptive",
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.compress(in, out, ArithmeticEncoder::Coder::Adaptive);
+        },
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.decompress(in, out);
+        },
+        {"arithmetic_encoder_1", "-a"},
+        {"arithmetic_encoder_1", "-d"}});
+    codecs.push_back({"arith1-cm",
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.compress(in, out, ArithmeticEncoder::Coder::ContextMix);
+        },
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.decompress(in, out);
+        },
+        {"arithmetic_encoder_1", "-m"},
+        {"arithmetic_encoder_1", "-d"}});
+    codecs.push_back({"arith1-split",
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.compress(in, out, ArithmeticEncoder::Coder::Split);
+        },
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.decompress(in, out);
+        },
+        {"arithmetic_encoder_1", "-b"},
+        {"arithmetic_encoder_1", "-d"}});
+    codecs.push_back({"arith1-x",
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.compress(in, out, ArithmeticEncoder::Coder::Classic, false, true);
+        },
+        [](const std::string& in, const std::string& out) {
+            ArithmeticEncoder encoder;
+            encoder.decompress(in, out);
+        },
+        {"arithmetic_encoder_1", "-x"},
+        {"arithmetic_encoder_1", "-d"}});
+    codecs.push_back({"arith2",
+        [](const std::string& in, const std::string& out) {
+            std::string i = in, o = out;
+            compress_ari(&i[0], &o[0]);
+        },
+        [](const std::string& in, const std::string& out) {
+            decompress_ari(in, out);
+        },
+        {"arithmetic_encoder_2", "c"},
+        {"arithmetic_encoder_2", "d"}});
+    return codecs;
+}
+
+} // namespace tai
+
+#endif
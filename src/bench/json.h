@@ -0,0 +1,240 @@
+#ifndef TAI_BENCH_JSON_H
+#define TAI_BENCH_JSON_H
+
+// Just enough JSON for benchmark reports: a value tree, a writer and a
+// strict parser (no \u escapes beyond ASCII, which the harness never emits).
+
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tai {
+namespace json {
+
+struct Value {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<Value> array;
+    std::map<std::string, Value> object;
+
+    Value() = default;
+    Value(bool b) : type(Type::Bool), boolean(b) {}
+    Value(double n) : type(Type::Number), number(n) {}
+    Value(long long n) : type(Type::Number), number(static_cast<double>(n)) {}
+    Value(int n) : type(Type::Number), number(n) {}
+    Value(const char* s) : type(Type::String), string(s) {}
+    Value(std::string s) : type(Type::String), string(std::move(s)) {}
+
+    static Value makeArray() { Value v; v.type = Type::Array; return v; }
+    static Value makeObject() { Value v; v.type = Type::Object; return v; }
+
+    Value& operator[](const std::string& key) {
+        type = Type::Object;
+        return object[key];
+    }
+
+    const Value* find(const std::string& key) const {
+        auto it = object.find(key);
+        return it == object.end() ? nullptr : &it->second;
+    }
+
+    double numberOr(const std::string& key, double fallback) const {
+        const Value* v = find(key);
+        return v != nullptr && v->type == Type::Number ? v->number : fallback;
+    }
+
+    std::string stringOr(const std::string& key, const std::string& fallback) const {
+        const Value* v = find(key);
+        return v != nullptr && v->type == Type::String ? v->string : fallback;
+    }
+};
+
+inline void writeString(std::ostream& out, const std::string& s) {
+    out << '"';
+    for (char c : s) {
+        switch (c) {
+            case '"':  out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out << buf;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+inline void write(std::ostream& out, const Value& v, int indent = 0) {
+    std::string pad(static_cast<size_t>(indent + 2), ' ');
+    switch (v.type) {
+        case Value::Type::Null: out << "null"; break;
+        case Value::Type::Bool: out << (v.boolean ? "true" : "false"); break;
+        case Value::Type::Number: {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.17g", v.number);
+            out << buf;
+            break;
+        }
+        case Value::Type::String: writeString(out, v.string); break;
+        case Value::Type::Array: {
+            out << "[";
+            for (size_t i = 0; i < v.array.size(); i++) {
+                out << (i ? ",\n" : "\n") << pad;
+                write(out, v.array[i], indent + 2);
+            }
+            out << (v.array.empty() ? "]" : "\n" + std::string(static_cast<size_t>(indent), ' ') + "]");
+            break;
+        }
+        case Value::Type::Object: {
+            out << "{";
+            bool first = true;
+            for (const auto& [key, value] : v.object) {
+                out << (first ? "\n" : ",\n") << pad;
+                writeString(out, key);
+                out << ": ";
+                write(out, value, indent + 2);
+                first = false;
+            }
+            out << (v.object.empty() ? "}" : "\n" + std::string(static_cast<size_t>(indent), ' ') + "}");
+            break;
+        }
+    }
+}
+
+class Parser {
+private:
+    const std::string& text;
+    size_t pos = 0;
+
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error("JSON parse error at offset " + std::to_string(pos) + ": " + what);
+    }
+
+    void skipSpace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' ||
+                                     text[pos] == '\r' || text[pos] == '\t')) {
+            pos++;
+        }
+    }
+
+    bool consume(const char* literal) {
+        size_t n = std::char_traits<char>::length(literal);
+        if (text.compare(pos, n, literal) == 0) {
+            pos += n;
+            return true;
+        }
+        return false;
+    }
+
+    std::string parseString() {
+        if (text[pos] != '"') fail("expected string");
+        pos++;
+        std::string s;
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c == '\\') {
+                if (pos >= text.size()) fail("bad escape");
+                char e = text[pos++];
+                switch (e) {
+                    case 'n': s += '\n'; break;
+                    case 't': s += '\t'; break;
+                    case 'r': s += '\r'; break;
+                    case 'b': s += '\b'; break;
+                    case 'f': s += '\f'; break;
+                    case 'u': {
+                        if (pos + 4 > text.size()) fail("bad \\u escape");
+                        s += static_cast<char>(std::stoi(text.substr(pos, 4), nullptr, 16) & 0x7F);
+                        pos += 4;
+                        break;
+                    }
+                    default: s += e;
+                }
+            } else {
+                s += c;
+            }
+        }
+        if (pos >= text.size()) fail("unterminated string");
+        pos++;
+        return s;
+    }
+
+    Value parseValue() {
+        skipSpace();
+        if (pos >= text.size()) fail("unexpected end");
+        char c = text[pos];
+        if (c == '{') {
+            pos++;
+            Value v = Value::makeObject();
+            skipSpace();
+            if (consume("}")) return v;
+            for (;;) {
+                skipSpace();
+                std::string key = parseString();
+                skipSpace();
+                if (!consume(":")) fail("expected ':'");
+                v.object[key] = parseValue();
+                skipSpace();
+                if (consume("}")) return v;
+                if (!consume(",")) fail("expected ',' or '}'");
+            }
+        }
+        if (c == '[') {
+            pos++;
+            Value v = Value::makeArray();
+            skipSpace();
+            if (consume("]")) return v;
+            for (;;) {
+                v.array.push_back(parseValue());
+                skipSpace();
+                if (consume("]")) return v;
+                if (!consume(",")) fail("expected ',' or ']'");
+            }
+        }
+        if (c == '"') return Value(parseString());
+        if (consume("true")) return Value(true);
+        if (consume("false")) return Value(false);
+        if (consume("null")) return Value();
+        size_t used = 0;
+        double n = 0;
+        try {
+            n = std::stod(text.substr(pos, 64), &used);
+        } catch (const std::exception&) {
+            fail("expected value");
+        }
+        pos += used;
+        return Value(n);
+    }
+
+public:
+    explicit Parser(const std::string& t) : text(t) {}
+
+    Value parse() {
+        Value v = parseValue();
+        skipSpace();
+        if (pos != text.size()) fail("trailing characters");
+        return v;
+    }
+};
+
+inline Value parse(const std::string& text) {
+    return Parser(text).parse();
+}
+
+} // namespace json
+} // namespace tai
+
+#endif
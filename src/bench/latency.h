@@ -0,0 +1,172 @@
+#ifndef TAI_BENCH_LATENCY_H
+#define TAI_BENCH_LATENCY_H
+
+// Small-record latency for the benchmark's -L: per-call compress and
+// decompress times of one payload, as percentiles.
+//
+// A payload is the first bytes of a corpus file (repeated if the file is
+// shorter). Each iteration compresses it and decompresses the result, timed
+// separately with steady_clock (nanosecond resolution on Linux), so the
+// tails show fixed per-call costs that bulk MB/s hides: table setup, header
+// I/O, file open and close. Two surfaces are measured:
+//
+//   api   the codec's in-process entry points (codecs.h), warm
+//   cli   the command-line tool, spawned per call, so process start,
+//         dynamic linking and static initialisation are included
+//
+// The first WARMUP iterations are dropped. Percentiles are nearest-rank, so
+// p99.9 is only distinct from the maximum with 1000 or more iterations.
+
+#include "bench_util.h"
+#include "codecs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fcntl.h>
+#include <fstream>
+#include <spawn.h>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <vector>
+
+extern char** environ;
+
+namespace tai {
+namespace bench {
+
+struct Percentiles {
+    double p50 = 0.0;       // seconds
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double max = 0.0;
+};
+
+struct LatencyPoint {
+    std::string surface;        // "api" or "cli"
+    size_t bytes = 0;
+    long long compressed_bytes = 0;
+    int iterations = 0;
+    Percentiles comp;
+    Percentiles decomp;
+    bool lossless = false;
+};
+
+namespace latency_detail {
+
+static const int WARMUP = 16;
+
+inline double nearestRank(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(q * static_cast<double>(sorted.size())));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+inline Percentiles percentiles(std::vector<double> samples) {
+    Percentiles p;
+    if (samples.empty()) return p;
+    std::sort(samples.begin(), samples.end());
+    p.p50 = nearestRank(samples, 0.50);
+    p.p99 = nearestRank(samples, 0.99);
+    p.p999 = nearestRank(samples, 0.999);
+    p.max = samples.back();
+    return p;
+}
+
+inline double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs argv with stdout and stderr discarded; throws unless it exits 0.
+inline void run(const std::vector<std::string>& argv) {
+    std::vector<char*> args;
+    for (const std::string& a : argv) args.push_back(const_cast<char*>(a.c_str()));
+    args.push_back(nullptr);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+    pid_t pid;
+    int err = posix_spawn(&pid, args[0], &actions, nullptr, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (err != 0) throw std::runtime_error("cannot start " + argv[0]);
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error(argv[0] + " failed");
+    }
+}
+
+template <typename Compress, typename Decompress>
+LatencyPoint measure(const std::string& surface, const std::string& payload, const TempDir& tmp,
+                     int iterations, Compress&& compress, Decompress&& decompress) {
+    std::string comp = tmp.path("latency.comp");
+    std::string decomp = tmp.path("latency.decomp");
+    std::vector<double> tc, td;
+    for (int i = 0; i < WARMUP + iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        compress(payload, comp);
+        double c = elapsed(start);
+        start = std::chrono::steady_clock::now();
+        decompress(comp, decomp);
+        double d = elapsed(start);
+        if (i >= WARMUP) {
+            tc.push_back(c);
+            td.push_back(d);
+        }
+    }
+    LatencyPoint point;
+    point.surface = surface;
+    point.bytes = static_cast<size_t>(std::filesystem::file_size(payload));
+    point.compressed_bytes = static_cast<long long>(std::filesystem::file_size(comp));
+    point.iterations = iterations;
+    point.comp = percentiles(tc);
+    point.decomp = percentiles(td);
+    point.lossless = sameContents(payload, decomp);
+    std::filesystem::remove(comp);
+    std::filesystem::remove(decomp);
+    return point;
+}
+
+} // namespace latency_detail
+
+// Writes the first bytes of corpus to path, repeating the file if it is
+// shorter.
+inline void writePayload(const std::string& corpus, const std::string& path, size_t bytes) {
+    std::ifstream in(corpus, std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.empty()) throw std::runtime_error("empty input: " + corpus);
+    std::ofstream out(path, std::ios::binary);
+    for (size_t done = 0; done < bytes;) {
+        size_t n = std::min(bytes - done, data.size());
+        out.write(data.data(), static_cast<std::streamsize>(n));
+        done += n;
+    }
+}
+
+inline LatencyPoint measureApi(const Codec& codec, const std::string& payload, const TempDir& tmp,
+                               int iterations) {
+    return latency_detail::measure("api", payload, tmp, iterations, codec.compress, codec.decompress);
+}
+
+// cli_compress and cli_decompress are the tool and its options; the input
+// and output paths are appended.
+inline LatencyPoint measureCli(const std::vector<std::string>& cli_compress,
+                               const std::vector<std::string>& cli_decompress,
+                               const std::string& payload, const TempDir& tmp, int iterations) {
+    auto command = [](std::vector<std::string> argv) {
+        return [argv](const std::string& in, const std::string& out) {
+            std::vector<std::string> full = argv;
+            full.push_back(in);
+            full.push_back(out);
+            latency_detail::run(full);
+        };
+    };
+    return latency_detail::measure("cli", payload, tmp, iterations, command(cli_compress),
+                                   command(cli_decompress));
+}
+
+} // namespace bench
+} // namespace tai
+
+#endif
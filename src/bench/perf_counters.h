@@ -0,0 +1,251 @@
+#ifndef TAI_BENCH_PERF_COUNTERS_H
+#define TAI_BENCH_PERF_COUNTERS_H
+
+// Hardware performance counters (perf_event_open) for the benchmark's -p.
+//
+// PerfCounters opens one counter group on the calling thread, user space
+// only, and reads it with a single read(). Events the machine refuses (no
+// PMU in a VM, perf_event_paranoid, a seccomp filter) are left out and
+// reported as n/a; when none opens, available() is false and reason() says
+// why, and the benchmark runs without counters. task-clock is a software
+// event and opens wherever perf_event_open is allowed at all.
+//
+// PhaseProfiler is the PhaseHook (common/phase.h) that charges counter
+// deltas to coder phases. Phases called once per symbol are sampled: only
+// every SAMPLE_EVERY-th call is read and the sums are scaled up, so the
+// reads do not swamp what they measure. Every measured call is charged the
+// counts of a back-to-back pair of reads less (readCost(), calibrated when
+// the group opens); that matters most for task-clock, which includes the
+// time in read() itself. Only the thread that created
+// the profiler is counted; work handed to other threads is not seen.
+
+#include "../common/phase.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <string>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace tai {
+namespace bench {
+
+enum class Counter : int {
+    Cycles,
+    Instructions,
+    BranchMisses,
+    L1dMisses,
+    LlcMisses,
+    DtlbMisses,
+    TaskClock,      // nanoseconds
+    COUNT
+};
+
+inline const char* counterName(Counter c) {
+    static const char* const names[] = {
+        "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses", "dtlb_misses", "task_clock_ns"
+    };
+    return names[static_cast<int>(c)];
+}
+
+inline constexpr int COUNTERS = static_cast<int>(Counter::COUNT);
+
+struct CounterValues {
+    double value[COUNTERS] = {};
+
+    CounterValues& operator+=(const CounterValues& o) {
+        for (int i = 0; i < COUNTERS; i++) value[i] += o.value[i];
+        return *this;
+    }
+    double operator[](Counter c) const { return value[static_cast<int>(c)]; }
+};
+
+class PerfCounters {
+private:
+    struct Event {
+        uint32_t type;
+        uint64_t config;
+    };
+
+    static uint64_t cacheMiss(uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    int leader = -1;
+    std::vector<int> fds;
+    std::vector<Counter> order;     // counter of the i-th value in a group read
+    bool opened[COUNTERS] = {};
+    std::string why;
+    CounterValues read_cost;
+
+public:
+    struct Snapshot {
+        uint64_t enabled = 0, running = 0;
+        uint64_t value[COUNTERS] = {};
+    };
+
+    PerfCounters() {
+        const Event events[COUNTERS] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D)},
+            {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_LL)},
+            {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_DTLB)},
+            {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+        };
+        for (int i = 0; i < COUNTERS; i++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[i].type;
+            attr.config = events[i].config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fd < 0) {
+                if (why.empty()) {
+                    why = std::string(counterName(static_cast<Counter>(i))) + ": " + std::strerror(errno);
+                }
+                continue;
+            }
+            if (leader < 0) leader = fd;
+            fds.push_back(fd);
+            order.push_back(static_cast<Counter>(i));
+            opened[i] = true;
+        }
+        if (leader < 0 && why.empty()) why = "no events";
+        if (leader >= 0) calibrate();
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds) close(fd);
+    }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return leader >= 0; }
+    bool has(Counter c) const { return opened[static_cast<int>(c)]; }
+
+    // First event that failed to open (with errno text), empty if all did.
+    const std::string& reason() const { return why; }
+
+    Snapshot snapshot() const {
+        // PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING:
+        // nr, time_enabled, time_running, value[nr]
+        uint64_t buf[3 + COUNTERS] = {};
+        Snapshot s;
+        if (leader < 0 || read(leader, buf, sizeof(buf)) <= 0) return s;
+        s.enabled = buf[1];
+        s.running = buf[2];
+        for (size_t i = 0; i < order.size() && i < buf[0]; i++) {
+            s.value[static_cast<int>(order[i])] = buf[3 + i];
+        }
+        return s;
+    }
+
+    // Counts between two snapshots, scaled up if the group was multiplexed
+    // off the PMU for part of the time.
+    static CounterValues delta(const Snapshot& a, const Snapshot& b) {
+        CounterValues d;
+        uint64_t enabled = b.enabled - a.enabled, running = b.running - a.running;
+        double scale = running > 0 && running < enabled ? static_cast<double>(enabled) / running : 1.0;
+        for (int i = 0; i < COUNTERS; i++) {
+            d.value[i] = static_cast<double>(b.value[i] - a.value[i]) * scale;
+        }
+        return d;
+    }
+
+    // What delta() reports for nothing between the two snapshots.
+    const CounterValues& readCost() const { return read_cost; }
+
+private:
+    void calibrate() {
+        const int PAIRS = 256;
+        for (int i = 0; i < PAIRS; i++) {
+            Snapshot a = snapshot();
+            read_cost += delta(a, snapshot());
+        }
+        for (double& v : read_cost.value) v /= PAIRS;
+    }
+};
+
+class PhaseProfiler : public PhaseHook {
+public:
+    static const uint64_t SAMPLE_EVERY = 64;
+
+    struct PhaseCounts {
+        uint64_t calls = 0;
+        uint64_t measured = 0;
+        CounterValues sum;
+
+        // Sum over every call, extrapolated from the measured ones.
+        CounterValues total() const {
+            CounterValues t = sum;
+            if (measured > 0 && measured < calls) {
+                for (double& v : t.value) v = v * static_cast<double>(calls) / static_cast<double>(measured);
+            }
+            return t;
+        }
+    };
+
+private:
+    static const int PHASES = static_cast<int>(Phase::COUNT);
+
+    const PerfCounters& counters;
+    std::thread::id owner = std::this_thread::get_id();
+    PhaseCounts phases[PHASES];
+    PerfCounters::Snapshot start[PHASES];
+    bool active[PHASES] = {};
+
+    static bool sampled(Phase phase) {
+        return phase == Phase::ProbabilityInc;
+    }
+
+public:
+    explicit PhaseProfiler(const PerfCounters& c) : counters(c) {}
+
+    void enter(Phase phase) override {
+        if (std::this_thread::get_id() != owner) return;
+        int i = static_cast<int>(phase);
+        uint64_t call = phases[i].calls++;
+        if (sampled(phase) && call % SAMPLE_EVERY != 0) return;
+        active[i] = true;
+        start[i] = counters.snapshot();
+    }
+
+    void exit(Phase phase) override {
+        int i = static_cast<int>(phase);
+        if (std::this_thread::get_id() != owner || !active[i]) return;
+        active[i] = false;
+        CounterValues d = PerfCounters::delta(start[i], counters.snapshot());
+        for (int c = 0; c < COUNTERS; c++) {
+            d.value[c] = std::max(0.0, d.value[c] - counters.readCost().value[c]);
+        }
+        phases[i].sum += d;
+        phases[i].measured++;
+    }
+
+    const PhaseCounts& counts(Phase phase) const { return phases[static_cast<int>(phase)]; }
+};
+
+// Installs a hook for the lifetime of the scope.
+class ScopedPhaseHook {
+public:
+    explicit ScopedPhaseHook(PhaseHook* hook) { phaseHook().store(hook); }
+    ~ScopedPhaseHook() { phaseHook().store(nullptr); }
+    ScopedPhaseHook(const ScopedPhaseHook&) = delete;
+    ScopedPhaseHook& operator=(const ScopedPhaseHook&) = delete;
+};
+
+} // namespace bench
+} // namespace tai
+
+#endif
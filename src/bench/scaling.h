@@ -0,0 +1,206 @@
+#ifndef TAI_BENCH_SCALING_H
+#define TAI_BENCH_SCALING_H
+
+// Multi-tenant scaling for the benchmark's -m: how a codec holds up when N
+// copies of it run at once and share memory bandwidth and the LLC, as on a
+// host running many compression jobs.
+//
+// Every job is a forked process, so jobs share nothing but the machine,
+// and wait4() reports each one's peak RSS. The jobs of a round are released
+// together through a pipe: first all compress the input, then, once every
+// job has reported, all decompress it. Aggregate MB/s is N inputs over the
+// wall time from release to the last report; per-job times are compared
+// with the single-job time as slowdown. Work a codec hands to its own
+// threads stays inside its job.
+
+#include "bench_util.h"
+#include "codecs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace tai {
+namespace bench {
+
+struct ScalingPoint {
+    int jobs = 0;
+    double comp_mbps = 0.0;         // aggregate over all jobs
+    double decomp_mbps = 0.0;
+    double comp_job = 0.0;          // median seconds per job
+    double decomp_job = 0.0;
+    long long rss_total_kb = 0;     // sum of the jobs' peaks
+    long long rss_job_kb = 0;       // largest single job
+    bool lossless = true;
+};
+
+namespace scaling_detail {
+
+struct Report {
+    int phase;          // 0: compress, 1: decompress
+    double seconds;     // negative if the job failed
+    int lossless;
+};
+
+inline void writeAll(int fd, const void* data, size_t n) {
+    const char* p = static_cast<const char*>(data);
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w <= 0) return;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+}
+
+inline bool readAll(int fd, void* data, size_t n) {
+    char* p = static_cast<char*>(data);
+    while (n > 0) {
+        ssize_t r = read(fd, p, n);
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+// Runs in the forked child and never returns; _exit() keeps the parent's
+// destructors (the TempDir among them) from running here.
+[[noreturn]] inline void job(const Codec& codec, const std::string& input, const std::string& comp,
+                             const std::string& decomp, int go, int done) {
+    char token;
+    Report report{0, -1.0, 0};
+    try {
+        if (!readAll(go, &token, 1)) _exit(1);
+        report.seconds = timeIt([&] { codec.compress(input, comp); });
+    } catch (...) {
+        report.seconds = -1.0;
+    }
+    writeAll(done, &report, sizeof(report));
+    bool compressed = report.seconds >= 0;
+    report = {1, -1.0, 0};
+    if (!readAll(go, &token, 1)) _exit(1);
+    try {
+        if (compressed) {
+            report.seconds = timeIt([&] { codec.decompress(comp, decomp); });
+            report.lossless = sameContents(input, decomp);
+        }
+    } catch (...) {
+        report.seconds = -1.0;
+    }
+    writeAll(done, &report, sizeof(report));
+    std::remove(comp.c_str());
+    std::remove(decomp.c_str());
+    _exit(0);
+}
+
+} // namespace scaling_detail
+
+// One round of n concurrent jobs.
+inline ScalingPoint runJobs(const Codec& codec, const std::string& input, long long bytes,
+                            const TempDir& tmp, int n) {
+    using namespace scaling_detail;
+    int go[2], done[2];
+    if (pipe(go) != 0 || pipe(done) != 0) throw std::runtime_error("pipe failed");
+    std::cout.flush();
+    std::cerr.flush();
+    std::vector<pid_t> pids;
+    for (int i = 0; i < n; i++) {
+        pid_t pid = fork();
+        if (pid < 0) throw std::runtime_error("fork failed");
+        if (pid == 0) {
+            close(go[1]);
+            close(done[0]);
+            std::string id = std::to_string(i);
+            job(codec, input, tmp.path("job" + id + ".comp"), tmp.path("job" + id + ".decomp"), go[0], done[1]);
+        }
+        pids.push_back(pid);
+    }
+    close(go[0]);
+    close(done[1]);
+
+    ScalingPoint point;
+    point.jobs = n;
+    std::vector<double> times[2];
+    double wall[2] = {0.0, 0.0};
+    bool failed = false;
+    for (int phase = 0; phase < 2; phase++) {
+        std::string tokens(static_cast<size_t>(n), 'g');
+        auto start = std::chrono::steady_clock::now();
+        writeAll(go[1], tokens.data(), tokens.size());
+        for (int i = 0; i < n; i++) {
+            Report report;
+            if (!readAll(done[0], &report, sizeof(report))) {
+                failed = true;
+                break;
+            }
+            if (report.seconds < 0) failed = true;
+            if (phase == 1 && !report.lossless) point.lossless = false;
+            times[phase].push_back(report.seconds);
+        }
+        wall[phase] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (failed) break;
+    }
+    close(go[1]);
+    close(done[0]);
+    for (pid_t pid : pids) {
+        int status = 0;
+        struct rusage ru;
+        if (wait4(pid, &status, 0, &ru) < 0) continue;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = true;
+        point.rss_total_kb += ru.ru_maxrss;
+        point.rss_job_kb = std::max<long long>(point.rss_job_kb, ru.ru_maxrss);
+    }
+    if (failed) throw std::runtime_error(codec.name + ": a job failed with " + std::to_string(n) + " running");
+
+    point.comp_mbps = mbPerSecond(bytes * n, wall[0]);
+    point.decomp_mbps = mbPerSecond(bytes * n, wall[1]);
+    point.comp_job = medianOf(times[0]);
+    point.decomp_job = medianOf(times[1]);
+    return point;
+}
+
+// 1, 2, 4, ... up to max_jobs (always included); each point is the median
+// of runs rounds, with the largest peak RSS.
+inline std::vector<ScalingPoint> runScaling(const Codec& codec, const std::string& input,
+                                            const TempDir& tmp, int max_jobs, int runs) {
+    long long bytes = static_cast<long long>(std::filesystem::file_size(input));
+    std::vector<int> levels;
+    for (int n = 1; n < max_jobs; n *= 2) levels.push_back(n);
+    levels.push_back(max_jobs);
+
+    std::vector<ScalingPoint> points;
+    for (int n : levels) {
+        std::vector<ScalingPoint> rounds;
+        for (int r = 0; r < runs; r++) rounds.push_back(runJobs(codec, input, bytes, tmp, n));
+        auto median = [&](double ScalingPoint::*field) {
+            std::vector<double> v;
+            for (const ScalingPoint& p : rounds) v.push_back(p.*field);
+            return medianOf(v);
+        };
+        ScalingPoint point;
+        point.jobs = n;
+        point.comp_mbps = median(&ScalingPoint::comp_mbps);
+        point.decomp_mbps = median(&ScalingPoint::decomp_mbps);
+        point.comp_job = median(&ScalingPoint::comp_job);
+        point.decomp_job = median(&ScalingPoint::decomp_job);
+        for (const ScalingPoint& p : rounds) {
+            point.rss_total_kb = std::max(point.rss_total_kb, p.rss_total_kb);
+            point.rss_job_kb = std::max(point.rss_job_kb, p.rss_job_kb);
+            point.lossless = point.lossless && p.lossless;
+        }
+        points.push_back(point);
+    }
+    return points;
+}
+
+} // namespace bench
+} // namespace tai
+
+#endif
@@ -0,0 +1,138 @@
+// Reads an ARIS archive of five frames through tai::ArchiveReader with a
+// cache capped at two frames: a fixed sequence with known hits, misses and
+// evictions (the cache must drop the least recently used frame, never the
+// one it just decoded), a cap below one frame, and random reads from several
+// threads. Every read is compared with the original bytes. Exits 1 if any
+// check fails.
+//   scripts/check_archive_reader.sh
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../coder/archive_reader.h"
+#include "../coder/compressed_streambuf.h"
+#include "check_util.h"
+
+namespace {
+
+const size_t FRAME = ArithmeticEncoder::STREAM_BLOCK_SIZE;
+const size_t CAP = 2 * FRAME;
+const unsigned THREADS = 4;
+const unsigned READS_PER_THREAD = 24;
+
+bool readMatches(tai::ArchiveReader& archive, const std::vector<unsigned char>& data, uint64_t offset,
+                 size_t n) {
+    std::vector<unsigned char> buf(n);
+    size_t expected = offset < data.size() ? std::min<size_t>(n, data.size() - offset) : 0;
+    if (archive.read(offset, buf.data(), n) != expected) return false;
+    return std::equal(buf.begin(), buf.begin() + expected, data.begin() + offset);
+}
+
+std::string counts(const tai::FrameCacheStats& s) {
+    return std::to_string(s.hits) + " hits, " + std::to_string(s.misses) + " misses, " +
+           std::to_string(s.evictions) + " evictions";
+}
+
+void checkSequence(tai::check::Report& report, const std::string& path, const std::vector<unsigned char>& data) {
+    tai::ArchiveReader archive(path, CAP);
+    report.expect(archive.size() == data.size() && archive.frameCount() == 5, "frame index");
+
+    // Frame read, in order, and whether it should hit. The cache holds two
+    // frames: reading 2 after 0 and 1 evicts 1, the least recently used,
+    // and keeps 0 and the frame just decoded.
+    const struct { unsigned frame; bool hit; } sequence[] = {
+        {0, false}, {0, true}, {1, false}, {0, true}, {2, false}, {2, true}, {0, true}, {1, false}, {0, true}
+    };
+    bool same = true, capped = true, expected = true;
+    for (const auto& step : sequence) {
+        uint64_t hits = archive.cacheStats().hits;
+        same = readMatches(archive, data, step.frame * FRAME + 10, 100) && same;
+        tai::FrameCacheStats s = archive.cacheStats();
+        capped = s.resident_bytes <= CAP && capped;
+        expected = (s.hits == hits + 1) == step.hit && expected;
+    }
+    tai::FrameCacheStats s = archive.cacheStats();
+    report.expect(same, "sequence: bytes match");
+    report.expect(capped && s.resident_frames == 2 && s.resident_bytes == CAP, "sequence: cap respected");
+    report.expect(expected && s.hits == 5 && s.misses == 4 && s.evictions == 2,
+                  "sequence: least recently used frame evicted (" + counts(s) + ")");
+
+    // Across the boundary of frames 3 and 4 (the short last frame), then
+    // past the end: two more misses, and the read is cut at the end.
+    bool across = readMatches(archive, data, 4 * FRAME - 500, 1000);
+    bool end = readMatches(archive, data, data.size() - 10, 100);
+    s = archive.cacheStats();
+    report.expect(across && end && s.misses == 6 && s.hits == 6 && s.resident_bytes <= CAP,
+                  "across frames and past the end (" + counts(s) + ")");
+}
+
+void checkOversized(tai::check::Report& report, const std::string& path, const std::vector<unsigned char>& data) {
+    tai::ArchiveReader archive(path, FRAME / 2);
+    bool same = readMatches(archive, data, 10, 100) && readMatches(archive, data, 20, 100);
+    tai::FrameCacheStats s = archive.cacheStats();
+    report.expect(same && s.hits == 0 && s.misses == 2 && s.resident_bytes == 0,
+                  "frames over the cap are decoded but not kept (" + counts(s) + ")");
+}
+
+void checkThreads(tai::check::Report& report, const std::string& path, const std::vector<unsigned char>& data) {
+    tai::ArchiveReader archive(path, CAP);
+    std::atomic<bool> same{true};
+    std::atomic<uint64_t> lookups{0};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < THREADS; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 rng(t + 1);
+            for (unsigned i = 0; i < READS_PER_THREAD; i++) {
+                // Mostly frames 0 and 1, so the cache both hits and evicts.
+                uint64_t span = i % 4 == 0 ? data.size() : 2 * FRAME;
+                uint64_t offset = rng() % span;
+                size_t n = 1 + rng() % (64 << 10);
+                if (!readMatches(archive, data, offset, n)) same = false;
+                uint64_t last = std::min<uint64_t>(offset + n, data.size()) - 1;
+                lookups += last / FRAME - offset / FRAME + 1;
+            }
+        });
+    }
+    for (std::thread& w : workers) w.join();
+    tai::FrameCacheStats s = archive.cacheStats();
+    report.expect(same, std::to_string(THREADS) + " threads: bytes match");
+    report.expect(s.resident_bytes <= CAP && s.resident_frames <= 2,
+                  std::to_string(THREADS) + " threads: cap respected");
+    // A miss inserts a frame unless another thread inserted it first.
+    report.expect(s.hits + s.misses == lookups && s.hits > 0 && s.misses >= s.resident_frames &&
+                  s.evictions <= s.misses - s.resident_frames,
+                  std::to_string(THREADS) + " threads: " + std::to_string(lookups.load()) + " lookups (" +
+                  counts(s) + ")");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <scratch_archive_path>" << std::endl;
+        return 1;
+    }
+    std::string path = argv[1];
+    tai::check::Report report;
+    try {
+        std::vector<unsigned char> data = tai::check::sampleData(4 * FRAME + FRAME / 4);
+        {
+            std::ofstream file(path, std::ios::binary);
+            tai::compressing_streambuf zbuf(file);
+            std::ostream out(&zbuf);
+            out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            zbuf.finish();
+        }
+        checkSequence(report, path, data);
+        checkOversized(report, path, data);
+        checkThreads(report, path, data);
+    } catch (const std::exception& e) {
+        report.expect(false, std::string("no exception: ") + e.what());
+    }
+    return report.exitCode();
+}
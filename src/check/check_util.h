@@ -0,0 +1,61 @@
+#ifndef TAI_CHECK_CHECK_UTIL_H
+#define TAI_CHECK_CHECK_UTIL_H
+
+// Sample data and reporting shared by the round-trip checks in src/check,
+// which the scripts/check_*.sh scripts build and run. Results print as
+// "ok    name" / "FAIL  name" lines, like scripts/check_pipes.sh.
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace tai {
+namespace check {
+
+// Word-like text with stretches of random bytes, generated from a fixed
+// seed so every run checks the same bytes.
+inline std::vector<unsigned char> sampleData(size_t bytes, uint64_t seed = 1) {
+    static const char* const words[] = {
+        "frame", "block", "coder", "range", "model", "symbol", "table", "stream",
+        "the", "of", "and", "to", "a", "in", "is", "for"
+    };
+    std::mt19937_64 rng(seed);
+    std::vector<unsigned char> out;
+    out.reserve(bytes);
+    while (out.size() < bytes) {
+        if (rng() % 64 == 0) {
+            for (size_t n = 16 + rng() % 256; n > 0 && out.size() < bytes; n--) {
+                out.push_back(static_cast<unsigned char>(rng()));
+            }
+            continue;
+        }
+        for (const char* w = words[rng() % 16]; *w && out.size() < bytes; w++) {
+            out.push_back(static_cast<unsigned char>(*w));
+        }
+        if (out.size() < bytes) out.push_back(rng() % 12 == 0 ? '\n' : ' ');
+    }
+    return out;
+}
+
+class Report {
+private:
+    bool failed = false;
+
+public:
+    void expect(bool ok, const std::string& name) {
+        std::cout << (ok ? "ok    " : "FAIL  ") << name << std::endl;
+        if (!ok) failed = true;
+    }
+
+    int exitCode() const {
+        return failed ? 1 : 0;
+    }
+};
+
+} // namespace check
+} // namespace tai
+
+#endif
@@ -0,0 +1,139 @@
+// Round trip through tai::compressing_streambuf / decompressing_streambuf
+// over an in-memory stream of a little more than two frames: bulk and
+// per-character writes and reads, seeks into a middle frame and reads
+// across frame boundaries. Exits 1 if any check fails.
+//   scripts/check_streambuf.sh
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../coder/compressed_streambuf.h"
+#include "check_util.h"
+
+namespace {
+
+const size_t FRAME = ArithmeticEncoder::STREAM_BLOCK_SIZE;
+
+std::string compressBulk(const std::vector<unsigned char>& data, ArithmeticEncoder::Coder coder) {
+    std::ostringstream file;
+    tai::compressing_streambuf zbuf(file, coder);
+    std::ostream out(&zbuf);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    zbuf.finish();
+    return file.str();
+}
+
+std::string compressPerChar(const std::vector<unsigned char>& data, ArithmeticEncoder::Coder coder) {
+    std::ostringstream file;
+    {
+        tai::compressing_streambuf zbuf(file, coder);
+        std::ostream out(&zbuf);
+        for (unsigned char c : data) out.put(static_cast<char>(c));
+        // finish() left to the destructor
+    }
+    return file.str();
+}
+
+bool sameRange(const std::vector<unsigned char>& data, size_t offset, const std::string& got) {
+    return offset + got.size() <= data.size() &&
+           std::equal(got.begin(), got.end(), data.begin() + offset,
+                      [](char a, unsigned char b) { return static_cast<unsigned char>(a) == b; });
+}
+
+// Reads n bytes at offset after seekg; empty on a failed seek.
+std::string readAt(std::istream& in, std::streamoff offset, size_t n) {
+    in.clear();
+    if (!in.seekg(offset)) return std::string();
+    if (in.tellg() != std::streampos(offset)) return std::string();
+    std::string got(n, '\0');
+    in.read(&got[0], static_cast<std::streamsize>(n));
+    got.resize(static_cast<size_t>(in.gcount()));
+    return got;
+}
+
+void checkCoder(tai::check::Report& report, const std::vector<unsigned char>& data,
+                ArithmeticEncoder::Coder coder, const std::string& label, bool per_char) {
+    std::string compressed = compressBulk(data, coder);
+
+    if (per_char) {
+        report.expect(compressPerChar(data, coder) == compressed,
+                      label + ": per-char writes give the same stream as bulk");
+    }
+
+    {
+        std::istringstream file(compressed);
+        tai::decompressing_streambuf zbuf(file);
+        std::istream in(&zbuf);
+        std::string got(data.size() + 10, '\0');
+        in.read(&got[0], static_cast<std::streamsize>(got.size()));
+        got.resize(static_cast<size_t>(in.gcount()));
+        report.expect(got.size() == data.size() && sameRange(data, 0, got) && in.eof(),
+                      label + ": bulk read");
+    }
+
+    if (per_char) {
+        std::istringstream file(compressed);
+        tai::decompressing_streambuf zbuf(file);
+        std::istream in(&zbuf);
+        size_t n = 0;
+        bool same = true;
+        for (int c; (c = in.get()) != std::char_traits<char>::eof(); n++) {
+            if (n >= data.size() || static_cast<unsigned char>(c) != data[n]) {
+                same = false;
+                break;
+            }
+        }
+        report.expect(same && n == data.size(), label + ": per-char read");
+    }
+
+    {
+        std::istringstream file(compressed);
+        tai::decompressing_streambuf zbuf(file);
+        std::istream in(&zbuf);
+        if (data.size() > 2 * FRAME) {
+            size_t middle = FRAME + FRAME / 2 + 17;
+            std::string got = readAt(in, static_cast<std::streamoff>(middle), 1000);
+            report.expect(got.size() == 1000 && sameRange(data, middle, got),
+                          label + ": seek into a middle frame");
+
+            size_t boundary = 2 * FRAME - 300;
+            std::string across = readAt(in, static_cast<std::streamoff>(boundary), 600);
+            report.expect(across.size() == 600 && sameRange(data, boundary, across),
+                          label + ": read across a frame boundary");
+        }
+
+        std::string back = readAt(in, 5, 100);
+        report.expect(back.size() == 100 && sameRange(data, 5, back), label + ": seek back to the first frame");
+
+        in.clear();
+        in.seekg(0, std::ios::end);
+        report.expect(in.tellg() == std::streampos(static_cast<std::streamoff>(data.size())) &&
+                      in.get() == std::char_traits<char>::eof(),
+                      label + ": seek to the end");
+
+        in.clear();
+        in.seekg(-50, std::ios::end);
+        std::string tail(50, '\0');
+        in.read(&tail[0], 50);
+        report.expect(in.gcount() == 50 && sameRange(data, data.size() - 50, tail),
+                      label + ": seek relative to the end");
+    }
+}
+
+} // namespace
+
+int main() {
+    tai::check::Report report;
+    try {
+        std::vector<unsigned char> data = tai::check::sampleData(2 * FRAME + FRAME / 3 + 321);
+        checkCoder(report, data, ArithmeticEncoder::Coder::Wide, "wide", true);
+        checkCoder(report, data, ArithmeticEncoder::Coder::Classic, "classic", false);
+        checkCoder(report, tai::check::sampleData(1000, 2), ArithmeticEncoder::Coder::Wide,
+                   "wide, one short frame", true);
+    } catch (const std::exception& e) {
+        report.expect(false, std::string("no exception: ") + e.what());
+    }
+    return report.exitCode();
+}
@@ -0,0 +1,125 @@
+#ifndef TAI_CODER_ARCHIVE_READER_H
+#define TAI_CODER_ARCHIVE_READER_H
+
+// Random-access reads from an encoder 1 file, for workloads that keep
+// returning to the same regions of a large archive.
+//
+//   tai::ArchiveReader archive("data.aris", 512 << 20);   // 512 MiB cache
+//   std::vector<char> buf(4096);
+//   archive.read(offset, buf.data(), buf.size());         // from any thread
+//
+// The frame index is built from the frame headers when the archive is
+// opened. Decoded frames go through a FrameCache, so a read that hits costs
+// a memcpy instead of a frame decode. Whole-file formats are one big frame;
+// the streaming ("ARIS") format is the one to use here.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../common/frame_cache.h"
+#include "arithmetic_encoder_1.h"
+
+namespace tai {
+
+class ArchiveReader {
+private:
+    struct FrameEntry {
+        std::streampos offset;      // of the frame header in the file
+        uint64_t start;             // of the frame's data in the decoded stream
+    };
+
+    std::string path;
+    ArithmeticEncoder::Coder coder;
+    tai::Transform transform;
+    bool framed;
+    std::vector<FrameEntry> index;
+    uint64_t total = 0;
+    FrameCache cache;
+
+    std::vector<unsigned char> decodeFrame(size_t i) const {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open input file");
+        in.seekg(index[i].offset);
+        ArithmeticEncoder engine;
+        std::vector<unsigned char> decoded;
+        if (framed) {
+            engine.readFrame(in, coder, decoded, i);
+        } else {
+            engine.readWholeFile(in, coder, decoded, transform);
+        }
+        return decoded;
+    }
+
+public:
+    // DEFAULT_CACHE_BYTES holds 64 frames of the streaming format.
+    static const size_t DEFAULT_CACHE_BYTES = 64 * ArithmeticEncoder::STREAM_BLOCK_SIZE;
+
+    explicit ArchiveReader(const std::string& file, size_t cache_bytes = DEFAULT_CACHE_BYTES)
+        : path(file), cache(cache_bytes) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open input file");
+        framed = ArithmeticEncoder::readFormat(in, coder, transform);
+        if (!framed) {
+            index.push_back({in.tellg(), 0});
+            if (transform != tai::Transform::None) {
+                // Only the transformed size is stored: decode to learn the real one.
+                total = cache.get(0, [this] { return decodeFrame(0); })->size();
+                return;
+            }
+            // The body starts with the decoded size.
+            total = ArithmeticEncoder::readBodySize(in, coder);
+            return;
+        }
+        for (;;) {
+            std::streampos offset = in.tellg();
+            uint32_t size = ArithmeticEncoder::skipFrame(in);
+            if (size == 0) break;
+            index.push_back({offset, total});
+            total += size;
+        }
+    }
+
+    ArchiveReader(const ArchiveReader&) = delete;
+    ArchiveReader& operator=(const ArchiveReader&) = delete;
+
+    // Decoded size of the archive.
+    uint64_t size() const {
+        return total;
+    }
+
+    size_t frameCount() const {
+        return index.size();
+    }
+
+    // Copies up to n bytes from decoded offset into dst; returns the number
+    // copied (short only at the end of the archive). Safe to call from
+    // several threads at once.
+    size_t read(uint64_t offset, void* dst, size_t n) {
+        unsigned char* out = static_cast<unsigned char*>(dst);
+        size_t done = 0;
+        while (done < n && offset < total) {
+            auto it = std::upper_bound(index.begin(), index.end(), offset,
+                [](uint64_t o, const FrameEntry& e) { return o < e.start; }) - 1;
+            size_t i = static_cast<size_t>(it - index.begin());
+            FrameCache::Frame frame = cache.get(i, [this, i] { return decodeFrame(i); });
+            size_t within = static_cast<size_t>(offset - it->start);
+            if (within >= frame->size()) throw std::runtime_error("Corrupt frame index");
+            size_t chunk = std::min(n - done, frame->size() - within);
+            std::memcpy(out + done, frame->data() + within, chunk);
+            done += chunk;
+            offset += chunk;
+        }
+        return done;
+    }
+
+    FrameCacheStats cacheStats() {
+        return cache.stats();
+    }
+};
+
+} // namespace tai
+
+#endif
@@ -1,370 +1,128 @@
-#include <iostream>
-#include <fstream>
-#include <vector>
-#include <map>
-#include <cmath>
-#include <iomanip>
-#include <algorithm>
-#include <cstdint>
-#include <limits>
-
-struct Statistics {
-    long long original_size;
-    long long compressed_size;
-    double compression_ratio;
-    long long space_saved;
-};
-
-class ArithmeticEncoder {
-private:
-    static const uint32_t MAX_RANGE = 0xFFFFFFFFu;
-    static const uint32_t HALF = 0x80000000u;
-    static const uint32_t FIRST_QTR = 0x40000000u;
-    static const uint32_t THIRD_QTR = 0xC0000000u;
-    
-    struct Symbol {
-        unsigned char value;
-        uint64_t low;
-        uint64_t high;
-        uint64_t count;
-    };
-
-    std::vector<Symbol> symbols;
-    uint64_t total_count = 0;
+#include "arithmetic_encoder_1.h"
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [-w|-a|-m|-b] [-x] [--verify-inline] [--trace FILE] <input_file> <output_file>\n"
+              << "   or: " << prog << " -d <input_file> <output_file>\n"
+              << "   or: " << prog << " [-d] [-w|-a|-m|-b] [--verify-inline] -c [input_file]\n"
+              << "   or: " << prog << " --selftest\n"
+              << "A file name of - means stdin/stdout; -c writes to stdout "
+                 "(streaming format, usable in pipelines).\n"
+              << "-w uses the 64-bit range coder (always used for inputs of 1 GiB or more);\n"
+              << "-a uses it with a quasi-static adaptive model, -m with context mixing\n"
+              << "(byte, word and indirect contexts; slower, much smaller on text).\n"
+              << "-b splits the input into blocks with a table each where its statistics\n"
+              << "drift (static and block-parallel in both directions).\n"
+              << "-x preprocesses the input when that helps (word dictionary for text,\n"
+              << "per-column streams for CSV and logs, E8/E9 filter for x86 code).\n"
+              << "--verify-inline decodes every block again while compressing and fails\n"
+              << "with the block index if it does not match the input.\n"
+              << "--trace FILE writes a timeline of read, model, encode, decode, write and\n"
+              << "verify spans per thread and block (Chrome trace format)." << std::endl;
+}
 
-    void buildFrequencyTable(const std::vector<unsigned char>& data) {
-        symbols.clear();
-        std::map<unsigned char, long long> freq;
-        for (unsigned char byte : data) {
-            freq[byte]++;
-        }
-        
-        total_count = data.size();
-        uint64_t cumulative = 0;
-        
-        for (auto& [value, count] : freq) {
-            symbols.push_back({value, cumulative, cumulative + static_cast<uint64_t>(count), static_cast<uint64_t>(count)});
-            cumulative += count;
-        }
+int main(int argc, char* argv[]) {
+    if (argc == 2 && std::string(argv[1]) == "--selftest") {
+        return tai::runKernelSelfTest(std::cout) ? 0 : 1;
     }
 
-    struct BitWriter {
-        std::vector<unsigned char> bytes;
-        uint8_t current = 0;
-        int bits_filled = 0;
-
-        void writeBit(int bit) {
-            current = static_cast<uint8_t>((current << 1) | (bit & 1));
-            bits_filled++;
-            if (bits_filled == 8) {
-                bytes.push_back(current);
-                current = 0;
-                bits_filled = 0;
-            }
-        }
-
-        void flush() {
-            if (bits_filled > 0) {
-                current <<= (8 - bits_filled);
-                bytes.push_back(current);
-                current = 0;
-                bits_filled = 0;
-            }
-        }
-    };
-
-    struct BitReader {
-        const std::vector<unsigned char>& bytes;
-        size_t index = 0;
-        uint8_t current = 0;
-        int bits_left = 0;
-
-        explicit BitReader(const std::vector<unsigned char>& data) : bytes(data) {}
-
-        int readBit() {
-            if (bits_left == 0) {
-                if (index >= bytes.size()) {
-                    return 0;
-                }
-                current = bytes[index++];
-                bits_left = 8;
-            }
-            int bit = (current >> 7) & 1;
-            current <<= 1;
-            bits_left--;
-            return bit;
-        }
-    };
-
-    void encodeData(const std::vector<unsigned char>& data, BitWriter& writer) {
-        uint32_t low = 0;
-        uint32_t high = MAX_RANGE;
-        uint32_t bits_to_follow = 0;
-
-        for (unsigned char byte : data) {
-            auto it = std::find_if(symbols.begin(), symbols.end(),
-                [byte](const Symbol& s) { return s.value == byte; });
-
-            if (it == symbols.end()) continue;
-
-            uint64_t range = static_cast<uint64_t>(high - low) + 1;
-            high = static_cast<uint32_t>(low + (range * it->high) / total_count - 1);
-            low = static_cast<uint32_t>(low + (range * it->low) / total_count);
-
-            for (;;) {
-                if (high < HALF) {
-                    writer.writeBit(0);
-                    while (bits_to_follow > 0) {
-                        writer.writeBit(1);
-                        bits_to_follow--;
-                    }
-                } else if (low >= HALF) {
-                    writer.writeBit(1);
-                    while (bits_to_follow > 0) {
-                        writer.writeBit(0);
-                        bits_to_follow--;
-                    }
-                    low -= HALF;
-                    high -= HALF;
-                } else if (low >= FIRST_QTR && high < THIRD_QTR) {
-                    bits_to_follow++;
-                    low -= FIRST_QTR;
-                    high -= FIRST_QTR;
-                } else {
-                    break;
-                }
-                low <<= 1;
-                high = (high << 1) | 1;
-            }
-        }
-
-        bits_to_follow++;
-        if (low < FIRST_QTR) {
-            writer.writeBit(0);
-            while (bits_to_follow-- > 0) writer.writeBit(1);
+    bool decompress = false;
+    bool to_stdout = false;
+    ArithmeticEncoder::Coder coder = ArithmeticEncoder::Coder::Classic;
+    bool verify_inline = false;
+    bool preprocess = false;
+    std::string trace;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-d") {
+            decompress = true;
+        } else if (arg == "-c") {
+            to_stdout = true;
+        } else if (arg == "-w") {
+            coder = ArithmeticEncoder::Coder::Wide;
+        } else if (arg == "-a") {
+            coder = ArithmeticEncoder::Coder::Adaptive;
+        } else if (arg == "-m") {
+            coder = ArithmeticEncoder::Coder::ContextMix;
+        } else if (arg == "-b") {
+            coder = ArithmeticEncoder::Coder::Split;
+        } else if (arg == "-x") {
+            preprocess = true;
+        } else if (arg == "--verify-inline") {
+            verify_inline = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace = argv[++i];
         } else {
-            writer.writeBit(1);
-            while (bits_to_follow-- > 0) writer.writeBit(0);
-        }
-        writer.flush();
-    }
-
-    void buildSymbolsFromCounts(const std::vector<std::pair<unsigned char, uint64_t>>& counts) {
-        symbols.clear();
-        total_count = 0;
-        uint64_t cumulative = 0;
-        for (const auto& [value, count] : counts) {
-            symbols.push_back({value, cumulative, cumulative + count, count});
-            cumulative += count;
-        }
-        total_count = cumulative;
-    }
-
-    unsigned char decodeSymbol(uint64_t cum) const {
-        for (const auto& s : symbols) {
-            if (cum >= s.low && cum < s.high) {
-                return s.value;
-            }
-        }
-        return 0;
-    }
-
-    void decodeData(BitReader& reader, std::vector<unsigned char>& output, uint64_t original_size) {
-        uint32_t low = 0;
-        uint32_t high = MAX_RANGE;
-        uint32_t value = 0;
-        for (int i = 0; i < 32; i++) {
-            value = (value << 1) | reader.readBit();
-        }
-
-        for (uint64_t i = 0; i < original_size; i++) {
-            uint64_t range = static_cast<uint64_t>(high - low) + 1;
-            uint64_t cum = ((static_cast<uint64_t>(value - low) + 1) * total_count - 1) / range;
-            unsigned char symbol_value = decodeSymbol(cum);
-            output.push_back(symbol_value);
-
-            auto it = std::find_if(symbols.begin(), symbols.end(),
-                [symbol_value](const Symbol& s) { return s.value == symbol_value; });
-            if (it == symbols.end()) continue;
-
-            high = static_cast<uint32_t>(low + (range * it->high) / total_count - 1);
-            low = static_cast<uint32_t>(low + (range * it->low) / total_count);
-
-            for (;;) {
-                if (high < HALF) {
-                    // do nothing
-                } else if (low >= HALF) {
-                    low -= HALF;
-                    high -= HALF;
-                    value -= HALF;
-                } else if (low >= FIRST_QTR && high < THIRD_QTR) {
-                    low -= FIRST_QTR;
-                    high -= FIRST_QTR;
-                    value -= FIRST_QTR;
-                } else {
-                    break;
-                }
-                low <<= 1;
-                high = (high << 1) | 1;
-                value = (value << 1) | reader.readBit();
-            }
-        }
-    }
-
-    static void writeUint64(std::ofstream& out, uint64_t v) {
-        for (int i = 0; i < 8; i++) {
-            out.put(static_cast<char>((v >> (56 - 8 * i)) & 0xFF));
-        }
-    }
-
-    static uint64_t readUint64(std::ifstream& in) {
-        uint64_t v = 0;
-        for (int i = 0; i < 8; i++) {
-            int c = in.get();
-            if (c == EOF) throw std::runtime_error("Unexpected EOF");
-            v = (v << 8) | static_cast<uint64_t>(static_cast<unsigned char>(c));
+            files.push_back(arg);
         }
-        return v;
     }
-
-    static void writeUint32(std::ofstream& out, uint32_t v) {
-        for (int i = 0; i < 4; i++) {
-            out.put(static_cast<char>((v >> (24 - 8 * i)) & 0xFF));
+    if (to_stdout) {
+        if (files.size() > 1) {
+            usage(argv[0]);
+            return 1;
         }
+        if (files.empty()) files.push_back("-");
+        files.push_back("-");
     }
-
-    static uint32_t readUint32(std::ifstream& in) {
-        uint32_t v = 0;
-        for (int i = 0; i < 4; i++) {
-            int c = in.get();
-            if (c == EOF) throw std::runtime_error("Unexpected EOF");
-            v = (v << 8) | static_cast<uint32_t>(static_cast<unsigned char>(c));
-        }
-        return v;
+    if (files.size() != 2 || (decompress && verify_inline)) {
+        usage(argv[0]);
+        return 1;
     }
-
-public:
-    Statistics compress(const std::string& input_file, const std::string& output_file) {
-        // Read input file
-        std::ifstream infile(input_file, std::ios::binary);
-        if (!infile) {
-            throw std::runtime_error("Cannot open input file");
-        }
-        
-        std::vector<unsigned char> data((std::istreambuf_iterator<char>(infile)),
-                                        std::istreambuf_iterator<char>());
-        infile.close();
-        
-        long long original_size = data.size();
-        
-        // Build frequency table
-        buildFrequencyTable(data);
-        
-        // Encode
-        BitWriter writer;
-        encodeData(data, writer);
-        
-        // Write output file
-        std::ofstream outfile(output_file, std::ios::binary);
-        if (!outfile) {
-            throw std::runtime_error("Cannot create output file");
-        }
-        outfile.write("ARIT", 4);
-        writeUint64(outfile, static_cast<uint64_t>(original_size));
-        writeUint32(outfile, static_cast<uint32_t>(symbols.size()));
-        for (const auto& s : symbols) {
-            outfile.put(static_cast<char>(s.value));
-            writeUint64(outfile, s.count);
-        }
-
-        outfile.write(reinterpret_cast<const char*>(writer.bytes.data()), writer.bytes.size());
-        outfile.close();
-        
-        long long compressed_size = static_cast<long long>(writer.bytes.size()) +
-                                    4 + 8 + 4 + static_cast<long long>(symbols.size()) * (1 + 8);
-        
-        return {
-            original_size,
-            compressed_size,
-            (double)compressed_size / original_size,
-            original_size - compressed_size
-        };
+    const std::string& input = files[0];
+    const std::string& output = files[1];
+    bool filter = input == "-" || output == "-";
+    if (preprocess && (filter || decompress)) {
+        // Transforms need the whole input; the streaming format has none.
+        std::cerr << "-x only applies to whole-file compression" << std::endl;
+        return 1;
     }
-
-    void decompress(const std::string& input_file, const std::string& output_file) {
-        std::ifstream infile(input_file, std::ios::binary);
-        if (!infile) {
-            throw std::runtime_error("Cannot open input file");
+    if (!trace.empty()) tai::Trace::start();
+    // Written on success and on error: a failed run's timeline shows where.
+    auto writeTrace = [&trace] {
+        if (!trace.empty() && !tai::Trace::write(trace)) {
+            std::cerr << "Cannot write trace: " << trace << std::endl;
         }
+    };
 
-        char magic[4];
-        infile.read(magic, 4);
-        if (infile.gcount() != 4 || std::string(magic, 4) != "ARIT") {
-            throw std::runtime_error("Invalid file format");
+    try {
+        ArithmeticEncoder encoder;
+        if (!filter) {
+            if (decompress) {
+                encoder.decompress(input, output);
+                std::cout << "Decompressed to: " << output << std::endl;
+            } else {
+                Statistics stats = encoder.compress(input, output, coder, verify_inline, preprocess);
+                encoder.printStatistics(stats);
+            }
+            writeTrace();
+            return 0;
         }
 
-        uint64_t original_size = readUint64(infile);
-        uint32_t symbol_count = readUint32(infile);
-        std::vector<std::pair<unsigned char, uint64_t>> counts;
-        counts.reserve(symbol_count);
-        for (uint32_t i = 0; i < symbol_count; i++) {
-            int v = infile.get();
-            if (v == EOF) throw std::runtime_error("Unexpected EOF");
-            uint64_t count = readUint64(infile);
-            counts.emplace_back(static_cast<unsigned char>(v), count);
+        std::ifstream infile;
+        std::ofstream outfile;
+        if (input != "-") {
+            infile.open(input, std::ios::binary);
+            if (!infile) throw std::runtime_error("Cannot open input file");
         }
-
-        std::vector<unsigned char> bitstream((std::istreambuf_iterator<char>(infile)),
-                                             std::istreambuf_iterator<char>());
-        infile.close();
-
-        buildSymbolsFromCounts(counts);
-
-        BitReader reader(bitstream);
-        std::vector<unsigned char> decoded;
-        decoded.reserve(static_cast<size_t>(original_size));
-        decodeData(reader, decoded, original_size);
-
-        std::ofstream outfile(output_file, std::ios::binary);
-        if (!outfile) {
-            throw std::runtime_error("Cannot create output file");
+        if (output != "-") {
+            outfile.open(output, std::ios::binary);
+            if (!outfile) throw std::runtime_error("Cannot create output file");
         }
-        outfile.write(reinterpret_cast<const char*>(decoded.data()), decoded.size());
-        outfile.close();
-    }
-
-    void printStatistics(const Statistics& stats) {
-        std::cout << "\n=== Compression Statistics ===" << std::endl;
-        std::cout << "Original size:     " << stats.original_size << " bytes" << std::endl;
-        std::cout << "Compressed size:   " << stats.compressed_size << " bytes" << std::endl;
-        std::cout << "Compression ratio: " << std::fixed << std::setprecision(4) 
-                  << stats.compression_ratio * 100 << "%" << std::endl;
-        std::cout << "Space saved:       " << stats.space_saved << " bytes ("
-                  << std::fixed << std::setprecision(2) 
-                  << (1 - stats.compression_ratio) * 100 << "%)" << std::endl;
-    }
-};
-
-int main(int argc, char* argv[]) {
-    if (argc != 3 && argc != 4) {
-        std::cerr << "Usage: " << argv[0] << " <input_file> <output_file>\n"
-                  << "   or: " << argv[0] << " -d <input_file> <output_file>" << std::endl;
-        return 1;
-    }
-    
-    try {
-        ArithmeticEncoder encoder;
-        if (argc == 4 && std::string(argv[1]) == "-d") {
-            encoder.decompress(argv[2], argv[3]);
-            std::cout << "Decompressed to: " << argv[3] << std::endl;
+        std::istream& in = input == "-" ? std::cin : static_cast<std::istream&>(infile);
+        std::ostream& out = output == "-" ? std::cout : static_cast<std::ostream&>(outfile);
+        if (decompress) {
+            encoder.decompress(in, out);
         } else {
-            Statistics stats = encoder.compress(argv[1], argv[2]);
-            encoder.printStatistics(stats);
+            Statistics stats = encoder.compressStream(in, out, coder, verify_inline);
+            // stdout may be carrying the compressed stream.
+            if (output != "-") encoder.printStatistics(stats);
         }
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
+        writeTrace();
         return 1;
     }
-    
+
+    writeTrace();
     return 0;
 }
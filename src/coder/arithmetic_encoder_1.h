@@ -0,0 +1,1525 @@
+#ifndef TAI_CODER_ARITHMETIC_ENCODER_1_H
+#define TAI_CODER_ARITHMETIC_ENCODER_1_H
+
+// Encoder 1: static-table arithmetic coder (classic 32-bit, 64-bit range
+// coder and quasi-static adaptive variants, plus a context-mixing model)
+// with whole-file and streaming formats. The command-line tool is
+// arithmetic_encoder_1.cpp.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <iomanip>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "../common/crc32c.h"
+#include "../common/histogram.h"
+#include "../common/kernels.h"
+#include "../common/parallel.h"
+#include "../common/phase.h"
+#include "../common/probes.h"
+#include "../common/statistics.h"
+#include "../common/trace.h"
+#include "../model/predictor.h"
+#include "../transform/transform.h"
+#include "range_coder64.h"
+#include "run_length.h"
+
+class ArithmeticEncoder {
+public:
+    // Entropy coder behind a payload; the value is the ARIS header's coder byte.
+    enum class Coder : uint8_t {
+        Classic = 0,    // bit-oriented 32-bit coder, static table
+        Wide = 1,       // 64-bit range coder, static table
+        Adaptive = 2,   // 64-bit range coder, quasi-static adaptive table
+        ContextMix = 3, // 64-bit range coder, bitwise context mixing (src/model)
+        Compact = 4,    // classic coder behind a varint size and symbol table
+        Split = 5,      // classic coder over blocks with a compact table each
+        LAST = Split
+    };
+
+    // Static-table coders store their symbol table; the adaptive ones
+    // learn as they go and store none, and Split keeps one per block inside
+    // its payload.
+    static bool hasSymbolTable(Coder coder) {
+        return coder == Coder::Classic || coder == Coder::Wide || coder == Coder::Compact;
+    }
+
+private:
+    static const uint32_t MAX_RANGE = 0xFFFFFFFFu;
+    static const uint32_t HALF = 0x80000000u;
+    static const uint32_t FIRST_QTR = 0x40000000u;
+    static const uint32_t THIRD_QTR = 0xC0000000u;
+    
+    struct Symbol {
+        unsigned char value;
+        uint64_t low;
+        uint64_t high;
+        uint64_t count;
+    };
+
+    std::vector<Symbol> symbols;
+    uint64_t total_count = 0;
+
+    void buildFrequencyTable(const std::vector<unsigned char>& data) {
+        TAI_PHASE(BuildFrequencyTable);
+        TAI_TRACE(Model);
+        symbols.clear();
+        tai::ByteHistogram freq = tai::ByteHistogram::of(data.data(), data.size());
+        
+        total_count = data.size();
+        uint64_t cumulative = 0;
+        
+        for (int value = 0; value < 256; value++) {
+            uint64_t count = freq.counts[value];
+            if (count == 0) continue;
+            symbols.push_back({static_cast<unsigned char>(value), cumulative, cumulative + count, count});
+            cumulative += count;
+        }
+    }
+
+    struct BitWriter {
+        std::vector<unsigned char> bytes;
+        uint8_t current = 0;
+        int bits_filled = 0;
+
+        void writeBit(int bit) {
+            current = static_cast<uint8_t>((current << 1) | (bit & 1));
+            bits_filled++;
+            if (bits_filled == 8) {
+                bytes.push_back(current);
+                current = 0;
+                bits_filled = 0;
+            }
+        }
+
+        void flush() {
+            if (bits_filled > 0) {
+                current <<= (8 - bits_filled);
+                bytes.push_back(current);
+                current = 0;
+                bits_filled = 0;
+            }
+        }
+    };
+
+    struct BitReader {
+        const std::vector<unsigned char>& bytes;
+        size_t index = 0;
+        uint8_t current = 0;
+        int bits_left = 0;
+
+        explicit BitReader(const std::vector<unsigned char>& data) : bytes(data) {}
+
+        int readBit() {
+            if (bits_left == 0) {
+                if (index >= bytes.size()) {
+                    return 0;
+                }
+                current = bytes[index++];
+                bits_left = 8;
+            }
+            int bit = (current >> 7) & 1;
+            current <<= 1;
+            bits_left--;
+            return bit;
+        }
+    };
+
+    void encodeData(const std::vector<unsigned char>& data, BitWriter& writer) {
+        TAI_PHASE(EncodeData);
+        uint32_t low = 0;
+        uint32_t high = MAX_RANGE;
+        uint32_t bits_to_follow = 0;
+
+        for (unsigned char byte : data) {
+            auto it = std::find_if(symbols.begin(), symbols.end(),
+                [byte](const Symbol& s) { return s.value == byte; });
+
+            if (it == symbols.end()) continue;
+
+            uint64_t range = static_cast<uint64_t>(high - low) + 1;
+            high = static_cast<uint32_t>(low + (range * it->high) / total_count - 1);
+            low = static_cast<uint32_t>(low + (range * it->low) / total_count);
+
+            for (;;) {
+                if (high < HALF) {
+                    writer.writeBit(0);
+                    while (bits_to_follow > 0) {
+                        writer.writeBit(1);
+                        bits_to_follow--;
+                    }
+                } else if (low >= HALF) {
+                    writer.writeBit(1);
+                    while (bits_to_follow > 0) {
+                        writer.writeBit(0);
+                        bits_to_follow--;
+                    }
+                    low -= HALF;
+                    high -= HALF;
+                } else if (low >= FIRST_QTR && high < THIRD_QTR) {
+                    bits_to_follow++;
+                    low -= FIRST_QTR;
+                    high -= FIRST_QTR;
+                } else {
+                    break;
+                }
+                low <<= 1;
+                high = (high << 1) | 1;
+            }
+        }
+
+        bits_to_follow++;
+        if (low < FIRST_QTR) {
+            writer.writeBit(0);
+            while (bits_to_follow-- > 0) writer.writeBit(1);
+        } else {
+            writer.writeBit(1);
+            while (bits_to_follow-- > 0) writer.writeBit(0);
+        }
+        writer.flush();
+    }
+
+    void buildSymbolsFromCounts(const std::vector<std::pair<unsigned char, uint64_t>>& counts) {
+        symbols.clear();
+        total_count = 0;
+        uint64_t cumulative = 0;
+        for (const auto& [value, count] : counts) {
+            symbols.push_back({value, cumulative, cumulative + count, count});
+            cumulative += count;
+        }
+        total_count = cumulative;
+    }
+
+    // Symbols are contiguous in cumulative order: the one holding cum is the
+    // first whose high is above it.
+    const Symbol* decodeSymbol(uint64_t cum) const {
+        auto it = std::upper_bound(symbols.begin(), symbols.end(), cum,
+            [](uint64_t c, const Symbol& s) { return c < s.high; });
+        return it != symbols.end() ? &*it : nullptr;
+    }
+
+    void decodeData(BitReader& reader, std::vector<unsigned char>& output, uint64_t original_size) {
+        TAI_PHASE(DecodeData);
+        uint32_t low = 0;
+        uint32_t high = MAX_RANGE;
+        uint32_t value = 0;
+        for (int i = 0; i < 32; i++) {
+            value = (value << 1) | reader.readBit();
+        }
+
+        for (uint64_t i = 0; i < original_size; i++) {
+            uint64_t range = static_cast<uint64_t>(high - low) + 1;
+            uint64_t cum = ((static_cast<uint64_t>(value - low) + 1) * total_count - 1) / range;
+            const Symbol* it = decodeSymbol(cum);
+            if (!it) throw std::runtime_error("Corrupt data");
+            output.push_back(it->value);
+
+            high = static_cast<uint32_t>(low + (range * it->high) / total_count - 1);
+            low = static_cast<uint32_t>(low + (range * it->low) / total_count);
+
+            for (;;) {
+                if (high < HALF) {
+                    // do nothing
+                } else if (low >= HALF) {
+                    low -= HALF;
+                    high -= HALF;
+                    value -= HALF;
+                } else if (low >= FIRST_QTR && high < THIRD_QTR) {
+                    low -= FIRST_QTR;
+                    high -= FIRST_QTR;
+                    value -= FIRST_QTR;
+                } else {
+                    break;
+                }
+                low <<= 1;
+                high = (high << 1) | 1;
+                value = (value << 1) | reader.readBit();
+            }
+        }
+    }
+
+    // Cumulative frequencies for the 64-bit range coder (range_coder64.h),
+    // indexed by byte value, plus a lookup table that makes decoding O(1).
+    struct CodingTable {
+        static const int LOOKUP_SIZE = 4096;
+        uint32_t cum[257];
+        uint32_t total = 0;
+        int lookup_shift = 0;
+        uint8_t lookup[LOOKUP_SIZE];    // lowest symbol that v >> lookup_shift can be
+
+        // Sets cum/total from per-symbol frequencies (total < 2^32).
+        void build(const uint32_t freq[256]) {
+            cum[0] = 0;
+            for (int v = 0; v < 256; v++) {
+                cum[v + 1] = cum[v] + freq[v];
+            }
+            total = cum[256];
+
+            lookup_shift = 0;
+            while ((static_cast<uint64_t>(total) >> lookup_shift) >= LOOKUP_SIZE) {
+                lookup_shift++;
+            }
+            int s = 0;
+            for (uint64_t k = 0; k < LOOKUP_SIZE; k++) {
+                uint64_t v = k << lookup_shift;
+                while (s < 255 && cum[s + 1] <= v) s++;
+                lookup[k] = static_cast<uint8_t>(s);
+            }
+        }
+
+        void encode(tai::RangeEncoder64& encoder, unsigned char byte) const {
+            encoder.encode(cum[byte], cum[byte + 1] - cum[byte], total);
+        }
+
+        unsigned char decode(tai::RangeDecoder64& decoder) const {
+            uint32_t v = decoder.peek(total);
+            int s = lookup[v >> lookup_shift];
+            while (cum[s + 1] <= v) s++;
+            decoder.consume(cum[s], cum[s + 1] - cum[s]);
+            return static_cast<unsigned char>(s);
+        }
+    };
+    CodingTable wide;
+
+    // Counts are scaled down only when the total does not fit in 32 bits;
+    // the scaling depends on the symbol table alone, so the decoder rebuilds
+    // the same table.
+    void buildWideTable() {
+        int shift = 0;
+        while ((total_count >> shift) + 256 > MAX_RANGE) shift++;
+        uint32_t freq[256] = {};
+        for (const auto& s : symbols) {
+            freq[s.value] = static_cast<uint32_t>(std::max<uint64_t>(1, s.count >> shift));
+        }
+        wide.build(freq);
+    }
+
+    void encodeDataWide(const std::vector<unsigned char>& data, std::vector<unsigned char>& out) {
+        TAI_PHASE(EncodeData);
+        buildWideTable();
+        tai::RangeEncoder64 encoder(out);
+        for (unsigned char byte : data) {
+            wide.encode(encoder, byte);
+        }
+        encoder.finish();
+    }
+
+    void decodeDataWide(const std::vector<unsigned char>& payload, std::vector<unsigned char>& output,
+                        uint64_t original_size) {
+        TAI_PHASE(DecodeData);
+        buildWideTable();
+        tai::RangeDecoder64 decoder(payload.data(), payload.size());
+        for (uint64_t i = 0; i < original_size; i++) {
+            output.push_back(wide.decode(decoder));
+        }
+    }
+
+    // Quasi-static model: symbols are coded with a fixed CodingTable, so the
+    // per-symbol path is the static one; counts accumulate in a side
+    // histogram and every `interval` symbols both sides rebuild the table.
+    // The interval doubles from FIRST_INTERVAL up to MAX_INTERVAL, and the
+    // counts are halved once they pass DECAY_LIMIT so the model keeps
+    // following the data.
+    struct QuasiStaticModel {
+        static const uint32_t FIRST_INTERVAL = 32;
+        static const uint32_t MAX_INTERVAL = 1u << 16;
+        static const uint32_t TABLE_TOTAL = 1u << 20;
+        static const uint64_t DECAY_LIMIT = uint64_t(1) << 20;
+
+        CodingTable table;
+        uint64_t counts[256];
+        uint64_t counted = 0;
+        uint32_t interval = FIRST_INTERVAL;
+        uint32_t until_rebuild = FIRST_INTERVAL;
+
+        QuasiStaticModel() {
+            std::fill(counts, counts + 256, 0);
+            rebuild();
+        }
+
+        // Every symbol keeps a frequency of at least 1; the rest of
+        // TABLE_TOTAL is shared out in proportion to the counts.
+        void rebuild() {
+            uint32_t freq[256];
+            uint64_t share = TABLE_TOTAL - 256;
+            for (int v = 0; v < 256; v++) {
+                freq[v] = 1 + static_cast<uint32_t>(counted ? counts[v] * share / counted : 0);
+            }
+            table.build(freq);
+            if (counted > DECAY_LIMIT) {
+                counted = 0;
+                for (int v = 0; v < 256; v++) {
+                    counts[v] >>= 1;
+                    counted += counts[v];
+                }
+            }
+        }
+
+        void update(unsigned char byte) {
+            counts[byte]++;
+            counted++;
+            if (--until_rebuild == 0) {
+                rebuild();
+                interval = std::min(interval * 2, MAX_INTERVAL);
+                until_rebuild = interval;
+            }
+        }
+    };
+
+    // The adaptive coders switch to run mode (run_length.h) after
+    // RUN_TRIGGER equal bytes. The decoder checks a decoded run against the
+    // bytes still to come, so a corrupt length cannot overrun the output.
+    static void appendRun(std::vector<unsigned char>& output, unsigned char byte, uint64_t n,
+                          uint64_t remaining) {
+        if (n > remaining) throw std::runtime_error("Corrupt run length");
+        output.insert(output.end(), static_cast<size_t>(n), byte);
+    }
+
+    void encodeDataAdaptive(const std::vector<unsigned char>& data, std::vector<unsigned char>& out) {
+        TAI_PHASE(EncodeData);
+        QuasiStaticModel model;
+        tai::RunLengthModel runs;
+        tai::RangeEncoder64 encoder(out);
+        for (size_t i = 0; i < data.size();) {
+            unsigned char byte = data[i++];
+            model.table.encode(encoder, byte);
+            model.update(byte);
+            if (runs.push(byte)) {
+                size_t n = runs.measure(data.data() + i, data.size() - i);
+                runs.encode(encoder, n);
+                i += n;
+            }
+        }
+        encoder.finish();
+    }
+
+    void decodeDataAdaptive(const std::vector<unsigned char>& payload, std::vector<unsigned char>& output,
+                            uint64_t original_size) {
+        TAI_PHASE(DecodeData);
+        QuasiStaticModel model;
+        tai::RunLengthModel runs;
+        tai::RangeDecoder64 decoder(payload.data(), payload.size());
+        const uint64_t end = output.size() + original_size;
+        while (output.size() < end) {
+            unsigned char byte = model.table.decode(decoder);
+            output.push_back(byte);
+            model.update(byte);
+            if (runs.push(byte)) {
+                appendRun(output, byte, runs.decode(decoder), end - output.size());
+            }
+        }
+    }
+
+    // Context mixing: every bit (MSB first) is one binary decision coded
+    // with the predictor's 12-bit probability of a 1. Runs are coded as in
+    // the adaptive coder and bypass the predictor.
+    void encodeDataContextMix(const std::vector<unsigned char>& data, std::vector<unsigned char>& out) {
+        TAI_PHASE(EncodeData);
+        tai::ContextMixPredictor predictor(data.size());
+        tai::RunLengthModel runs;
+        tai::RangeEncoder64 encoder(out);
+        for (size_t n = 0; n < data.size();) {
+            unsigned char byte = data[n++];
+            for (int i = 7; i >= 0; i--) {
+                int bit = (byte >> i) & 1;
+                uint32_t p = static_cast<uint32_t>(predictor.p());
+                if (bit) {
+                    encoder.encode(0, p, 4096);
+                } else {
+                    encoder.encode(p, 4096 - p, 4096);
+                }
+                predictor.update(bit);
+            }
+            if (runs.push(byte)) {
+                size_t run = runs.measure(data.data() + n, data.size() - n);
+                runs.encode(encoder, run);
+                n += run;
+            }
+        }
+        encoder.finish();
+    }
+
+    void decodeDataContextMix(const std::vector<unsigned char>& payload, std::vector<unsigned char>& output,
+                              uint64_t original_size) {
+        TAI_PHASE(DecodeData);
+        tai::ContextMixPredictor predictor(original_size);
+        tai::RunLengthModel runs;
+        tai::RangeDecoder64 decoder(payload.data(), payload.size());
+        const uint64_t end = output.size() + original_size;
+        while (output.size() < end) {
+            int byte = 0;
+            for (int k = 0; k < 8; k++) {
+                uint32_t p = static_cast<uint32_t>(predictor.p());
+                int bit = decoder.peek(4096) < p;
+                if (bit) {
+                    decoder.consume(0, p);
+                } else {
+                    decoder.consume(p, 4096 - p);
+                }
+                predictor.update(bit);
+                byte = byte * 2 + bit;
+            }
+            output.push_back(static_cast<unsigned char>(byte));
+            if (runs.push(static_cast<unsigned char>(byte))) {
+                appendRun(output, static_cast<unsigned char>(byte), runs.decode(decoder),
+                          end - output.size());
+            }
+        }
+    }
+
+    static void writeUint64(std::ostream& out, uint64_t v) {
+        for (int i = 0; i < 8; i++) {
+            out.put(static_cast<char>((v >> (56 - 8 * i)) & 0xFF));
+        }
+    }
+
+    static uint64_t readUint64(std::istream& in) {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; i++) {
+            int c = in.get();
+            if (c == EOF) throw std::runtime_error("Unexpected EOF");
+            v = (v << 8) | static_cast<uint64_t>(static_cast<unsigned char>(c));
+        }
+        return v;
+    }
+
+    static void writeUint32(std::ostream& out, uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            out.put(static_cast<char>((v >> (24 - 8 * i)) & 0xFF));
+        }
+    }
+
+    static uint32_t readUint32(std::istream& in) {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++) {
+            int c = in.get();
+            if (c == EOF) throw std::runtime_error("Unexpected EOF");
+            v = (v << 8) | static_cast<uint32_t>(static_cast<unsigned char>(c));
+        }
+        return v;
+    }
+
+    void writeSymbolTable(std::ostream& out) const {
+        writeUint32(out, static_cast<uint32_t>(symbols.size()));
+        for (const auto& s : symbols) {
+            out.put(static_cast<char>(s.value));
+            writeUint64(out, s.count);
+        }
+    }
+
+    void readSymbolTable(std::istream& in) {
+        uint32_t symbol_count = readUint32(in);
+        if (symbol_count > 256) throw std::runtime_error("Invalid symbol table");
+        std::vector<std::pair<unsigned char, uint64_t>> counts;
+        counts.reserve(symbol_count);
+        for (uint32_t i = 0; i < symbol_count; i++) {
+            int v = in.get();
+            if (v == EOF) throw std::runtime_error("Unexpected EOF");
+            uint64_t count = readUint64(in);
+            counts.emplace_back(static_cast<unsigned char>(v), count);
+        }
+        buildSymbolsFromCounts(counts);
+    }
+
+    static size_t symbolTableSize(size_t symbol_count) {
+        return 4 + symbol_count * (1 + 8);
+    }
+
+    // LEB128: 7 bits per byte, low group first, high bit set on all but the last.
+    static size_t writeVarint(std::ostream& out, uint64_t v) {
+        size_t n = 1;
+        for (; v >= 0x80; v >>= 7, n++) {
+            out.put(static_cast<char>((v & 0x7F) | 0x80));
+        }
+        out.put(static_cast<char>(v));
+        return n;
+    }
+
+    static uint64_t readVarint(std::istream& in) {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int c = in.get();
+            if (c == EOF) throw std::runtime_error("Unexpected EOF");
+            v |= static_cast<uint64_t>(c & 0x7F) << shift;
+            if (!(c & 0x80)) return v;
+        }
+        throw std::runtime_error("Invalid varint");
+    }
+
+    // Compact table: varint symbol count, the symbols (a list of values when
+    // there are fewer than COMPACT_BITMAP_SYMBOLS, otherwise a 256-bit
+    // bitmap), then one varint count per symbol in value order. A 1 KB text
+    // needs about 100 bytes here against 4 + 9 per symbol for the fixed one.
+    static const size_t COMPACT_BITMAP_SYMBOLS = 32;
+
+    size_t writeCompactSymbolTable(std::ostream& out) const {
+        size_t n = writeVarint(out, symbols.size());
+        if (symbols.size() < COMPACT_BITMAP_SYMBOLS) {
+            for (const auto& s : symbols) out.put(static_cast<char>(s.value));
+            n += symbols.size();
+        } else {
+            unsigned char bitmap[32] = {};
+            for (const auto& s : symbols) bitmap[s.value >> 3] |= static_cast<unsigned char>(1 << (s.value & 7));
+            out.write(reinterpret_cast<const char*>(bitmap), sizeof(bitmap));
+            n += sizeof(bitmap);
+        }
+        for (const auto& s : symbols) n += writeVarint(out, s.count);
+        return n;
+    }
+
+    void readCompactSymbolTable(std::istream& in) {
+        uint64_t symbol_count = readVarint(in);
+        if (symbol_count > 256) throw std::runtime_error("Invalid symbol table");
+        std::vector<unsigned char> values;
+        values.reserve(static_cast<size_t>(symbol_count));
+        if (symbol_count < COMPACT_BITMAP_SYMBOLS) {
+            for (uint64_t i = 0; i < symbol_count; i++) {
+                int v = in.get();
+                if (v == EOF) throw std::runtime_error("Unexpected EOF");
+                values.push_back(static_cast<unsigned char>(v));
+            }
+        } else {
+            unsigned char bitmap[32];
+            in.read(reinterpret_cast<char*>(bitmap), sizeof(bitmap));
+            if (in.gcount() != sizeof(bitmap)) throw std::runtime_error("Unexpected EOF");
+            for (int v = 0; v < 256; v++) {
+                if (bitmap[v >> 3] & (1 << (v & 7))) values.push_back(static_cast<unsigned char>(v));
+            }
+            if (values.size() != symbol_count) throw std::runtime_error("Invalid symbol table");
+        }
+        std::vector<std::pair<unsigned char, uint64_t>> counts;
+        counts.reserve(values.size());
+        for (unsigned char v : values) counts.emplace_back(v, readVarint(in));
+        buildSymbolsFromCounts(counts);
+    }
+
+    // Start of a whole-file body: the coded size and, for static-table
+    // coders, the table; Compact stores both in their compact forms, Split
+    // the size as a varint. Returns the bytes written.
+    size_t writeBodyHeader(std::ostream& out, Coder coder, uint64_t coded_size) const {
+        if (coder == Coder::Compact) {
+            return writeVarint(out, coded_size) + writeCompactSymbolTable(out);
+        }
+        if (coder == Coder::Split) return writeVarint(out, coded_size);
+        writeUint64(out, coded_size);
+        if (!hasSymbolTable(coder)) return 8;
+        writeSymbolTable(out);
+        return 8 + symbolTableSize(symbols.size());
+    }
+
+    uint64_t readBodyHeader(std::istream& in, Coder coder) {
+        uint64_t coded_size = readBodySize(in, coder);
+        if (coder == Coder::Compact) {
+            readCompactSymbolTable(in);
+        } else if (hasSymbolTable(coder)) {
+            readSymbolTable(in);
+        }
+        return coded_size;
+    }
+
+    // Split coder ("ARIB"): the input is cut into blocks whose statistics
+    // differ enough to pay for a table of their own, each coded by the
+    // classic coder behind a compact table. The boundaries come from a
+    // greedy merge: the input starts as sub-blocks of SPLIT_UNIT bytes (at
+    // most MAX_SPLIT_UNITS of them; larger units for larger inputs), whose
+    // histograms are counted in parallel, and the adjacent pair whose merge
+    // saves the most bits (order-0 cost plus table and block overhead) is
+    // merged until no merge saves anything or the block would exceed
+    // MAX_SPLIT_BLOCK. Payload:
+    //   varint block_count { varint raw_size compact_table varint payload_size payload }*
+    // Blocks are independent, so both directions code them in parallel.
+    static const size_t SPLIT_UNIT = size_t(16) << 10;
+    static const size_t MAX_SPLIT_UNITS = 4096;
+    static const size_t MAX_SPLIT_BLOCK = size_t(16) << 20;
+    static const uint64_t SPLIT_BLOCK_OVERHEAD_BITS = 6 * 8;    // two varints and the coder flush
+
+    static size_t varintSize(uint64_t v) {
+        size_t n = 1;
+        for (; v >= 0x80; v >>= 7) n++;
+        return n;
+    }
+
+    // Estimated size in bits of a block coded with its own compact table.
+    static uint64_t splitBlockCost(const tai::ByteHistogram& h) {
+        size_t distinct = 0, table = 0;
+        for (uint64_t count : h.counts) {
+            if (count == 0) continue;
+            distinct++;
+            table += varintSize(count);
+        }
+        table += varintSize(distinct) + std::min(distinct, COMPACT_BITMAP_SYMBOLS);
+        return tai::order0CostBits(h) + table * 8 + SPLIT_BLOCK_OVERHEAD_BITS;
+    }
+
+    // End offsets of the blocks encodeDataSplit codes data in.
+    static std::vector<size_t> splitPoints(const std::vector<unsigned char>& data) {
+        TAI_TRACE(Model);
+        const size_t NONE = ~size_t(0);
+        struct Block {
+            size_t begin, end;
+            tai::ByteHistogram hist;
+            uint64_t cost;
+            size_t prev, next;
+            uint32_t version;
+        };
+        size_t unit = std::max(SPLIT_UNIT, (data.size() + MAX_SPLIT_UNITS - 1) / MAX_SPLIT_UNITS);
+        size_t n = (data.size() + unit - 1) / unit;
+        std::vector<Block> blocks(n);
+        tai::parallelFor(n, [&](size_t i) {
+            Block& b = blocks[i];
+            b.begin = i * unit;
+            b.end = std::min(data.size(), b.begin + unit);
+            b.hist = tai::ByteHistogram::of(data.data() + b.begin, b.end - b.begin);
+            b.cost = splitBlockCost(b.hist);
+            b.prev = i > 0 ? i - 1 : NONE;
+            b.next = i + 1 < n ? i + 1 : NONE;
+            b.version = 0;
+        });
+
+        // Merge candidates by saving; stale ones (either side changed since)
+        // are skipped when popped.
+        struct Candidate {
+            uint64_t gain;
+            size_t left;
+            uint32_t left_version, right_version;
+            bool operator<(const Candidate& o) const { return gain < o.gain; }
+        };
+        std::priority_queue<Candidate> queue;
+        auto merged = [&](const Block& a, const Block& b) {
+            tai::ByteHistogram h = a.hist;
+            for (int v = 0; v < 256; v++) h.counts[v] += b.hist.counts[v];
+            h.total += b.hist.total;
+            return h;
+        };
+        auto consider = [&](size_t left) {
+            if (left == NONE || blocks[left].next == NONE) return;
+            const Block& a = blocks[left];
+            const Block& b = blocks[a.next];
+            if (b.end - a.begin > MAX_SPLIT_BLOCK) return;
+            uint64_t cost = splitBlockCost(merged(a, b));
+            if (cost < a.cost + b.cost) queue.push({a.cost + b.cost - cost, left, a.version, b.version});
+        };
+        for (size_t i = 0; i + 1 < n; i++) consider(i);
+        while (!queue.empty()) {
+            Candidate c = queue.top();
+            queue.pop();
+            Block& a = blocks[c.left];
+            if (a.version != c.left_version || a.next == NONE || blocks[a.next].version != c.right_version) {
+                continue;
+            }
+            Block& b = blocks[a.next];
+            a.hist = merged(a, b);
+            a.cost = splitBlockCost(a.hist);
+            a.end = b.end;
+            a.next = b.next;
+            a.version++;
+            b.version++;
+            if (a.next != NONE) blocks[a.next].prev = c.left;
+            consider(a.prev);
+            consider(c.left);
+        }
+
+        std::vector<size_t> ends;
+        for (size_t i = n > 0 ? 0 : NONE; i != NONE; i = blocks[i].next) ends.push_back(blocks[i].end);
+        return ends;
+    }
+
+    void encodeDataSplit(const std::vector<unsigned char>& data, std::vector<unsigned char>& out) {
+        std::vector<size_t> ends = splitPoints(data);
+        std::vector<std::string> bodies(ends.size());
+        tai::parallelFor(ends.size(), [&](size_t i) {
+            TAI_TRACE_BLOCK(Encode, i);
+            size_t begin = i > 0 ? ends[i - 1] : 0;
+            std::vector<unsigned char> block(data.begin() + static_cast<std::ptrdiff_t>(begin),
+                                             data.begin() + static_cast<std::ptrdiff_t>(ends[i]));
+            ArithmeticEncoder engine;
+            engine.buildFrequencyTable(block);
+            BitWriter writer;
+            engine.encodeData(block, writer);
+            std::ostringstream body;
+            writeVarint(body, block.size());
+            engine.writeCompactSymbolTable(body);
+            writeVarint(body, writer.bytes.size());
+            body.write(reinterpret_cast<const char*>(writer.bytes.data()),
+                       static_cast<std::streamsize>(writer.bytes.size()));
+            bodies[i] = body.str();
+        });
+        std::ostringstream header;
+        writeVarint(header, bodies.size());
+        std::string count = header.str();
+        out.assign(count.begin(), count.end());
+        for (const std::string& body : bodies) out.insert(out.end(), body.begin(), body.end());
+    }
+
+    // Reads a payload in place, for the header fields inside it.
+    class PayloadReader : public std::streambuf {
+    public:
+        PayloadReader(const std::vector<unsigned char>& payload, size_t position) {
+            char* base = reinterpret_cast<char*>(const_cast<unsigned char*>(payload.data()));
+            setg(base, base + position, base + payload.size());
+        }
+        size_t position() const { return static_cast<size_t>(gptr() - eback()); }
+        void skip(size_t n) { setg(eback(), gptr() + n, egptr()); }
+    };
+
+    void decodeDataSplit(const std::vector<unsigned char>& payload, std::vector<unsigned char>& output,
+                         uint64_t original_size) {
+        struct Block {
+            uint64_t offset, raw_size;
+            size_t table, data, size;
+        };
+        PayloadReader buf(payload, 0);
+        std::istream in(&buf);
+        uint64_t count = readVarint(in);
+        if (count > original_size) throw std::runtime_error("Invalid block count");
+        std::vector<Block> blocks;
+        blocks.reserve(static_cast<size_t>(count));
+        uint64_t offset = 0;
+        ArithmeticEncoder scratch;
+        for (uint64_t i = 0; i < count; i++) {
+            Block b;
+            b.offset = offset;
+            b.raw_size = readVarint(in);
+            if (b.raw_size == 0 || b.raw_size > original_size - offset) throw std::runtime_error("Invalid block size");
+            b.table = buf.position();
+            scratch.readCompactSymbolTable(in);
+            uint64_t size = readVarint(in);
+            b.data = buf.position();
+            if (size > payload.size() - b.data) throw std::runtime_error("Unexpected EOF");
+            b.size = static_cast<size_t>(size);
+            buf.skip(b.size);
+            offset += b.raw_size;
+            blocks.push_back(b);
+        }
+        if (offset != original_size) throw std::runtime_error("Invalid block sizes");
+
+        size_t start = output.size();
+        output.resize(start + static_cast<size_t>(original_size));
+        tai::parallelFor(blocks.size(), [&](size_t i) {
+            TAI_TRACE_BLOCK(Decode, i);
+            const Block& b = blocks[i];
+            PayloadReader table(payload, b.table);
+            std::istream table_in(&table);
+            ArithmeticEncoder engine;
+            engine.readCompactSymbolTable(table_in);
+            std::vector<unsigned char> bits(payload.begin() + static_cast<std::ptrdiff_t>(b.data),
+                                            payload.begin() + static_cast<std::ptrdiff_t>(b.data + b.size));
+            BitReader reader(bits);
+            std::vector<unsigned char> decoded;
+            decoded.reserve(static_cast<size_t>(b.raw_size));
+            engine.decodeData(reader, decoded, b.raw_size);
+            std::copy(decoded.begin(), decoded.end(), output.begin() + static_cast<std::ptrdiff_t>(start + b.offset));
+        });
+    }
+
+    // Fills data with up to max bytes from in; returns the number read.
+    // block labels the read in a trace.
+    static size_t readBlock(std::istream& in, std::vector<unsigned char>& data, size_t max,
+                            int64_t block = tai::Trace::NO_BLOCK) {
+        TAI_TRACE_BLOCK(Read, block);
+        data.resize(max);
+        TAI_PROBE1(io__wait__start, 0);
+        in.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(max));
+        TAI_PROBE2(io__wait__end, 0, in.gcount());
+        data.resize(static_cast<size_t>(in.gcount()));
+        if (in.bad()) throw std::runtime_error("Read error");
+        return data.size();
+    }
+
+    static Statistics makeStatistics(long long original_size, long long compressed_size) {
+        return {
+            original_size,
+            compressed_size,
+            (double)compressed_size / original_size,
+            original_size - compressed_size
+        };
+    }
+
+    // Builds the static table (written by writeSymbolTable) when the coder
+    // uses one, and encodes data into bytes.
+    void encodePayload(const std::vector<unsigned char>& data, Coder coder,
+                       std::vector<unsigned char>& bytes) {
+        if (!hasSymbolTable(coder)) {
+            symbols.clear();
+            total_count = 0;
+            if (coder == Coder::Adaptive) {
+                encodeDataAdaptive(data, bytes);
+            } else if (coder == Coder::Split) {
+                encodeDataSplit(data, bytes);
+            } else {
+                encodeDataContextMix(data, bytes);
+            }
+            return;
+        }
+        buildFrequencyTable(data);
+        if (coder == Coder::Wide) {
+            encodeDataWide(data, bytes);
+        } else {
+            BitWriter writer;
+            encodeData(data, writer);
+            bytes = std::move(writer.bytes);
+        }
+    }
+
+    // Decodes one payload with the coder its header named.
+    void decodePayload(const std::vector<unsigned char>& payload, Coder coder,
+                       std::vector<unsigned char>& decoded, uint64_t original_size) {
+        if (coder == Coder::Adaptive) {
+            decodeDataAdaptive(payload, decoded, original_size);
+        } else if (coder == Coder::ContextMix) {
+            decodeDataContextMix(payload, decoded, original_size);
+        } else if (coder == Coder::Split) {
+            decodeDataSplit(payload, decoded, original_size);
+        } else if (coder == Coder::Wide) {
+            decodeDataWide(payload, decoded, original_size);
+        } else {
+            BitReader reader(payload);
+            decodeData(reader, decoded, original_size);
+        }
+    }
+
+    void decompressWholeFile(std::istream& in, std::ostream& out, Coder coder, tai::Transform transform) {
+        std::vector<unsigned char> decoded;
+        readWholeFile(in, coder, decoded, transform);
+
+        TAI_TRACE_BLOCK(Write, 0);
+        TAI_PROBE1(io__wait__start, 1);
+        out.write(reinterpret_cast<const char*>(decoded.data()), decoded.size());
+        TAI_PROBE2(io__wait__end, 1, decoded.size());
+    }
+
+    void decompressFrames(std::istream& in, std::ostream& out, Coder coder) {
+        std::vector<unsigned char> decoded;
+        for (uint64_t frame = 0; readFrame(in, coder, decoded, frame); frame++) {
+            TAI_TRACE_BLOCK(Write, frame);
+            TAI_PROBE1(io__wait__start, 1);
+            out.write(reinterpret_cast<const char*>(decoded.data()), decoded.size());
+            TAI_PROBE2(io__wait__end, 1, decoded.size());
+            if (!out) throw std::runtime_error("Write error");
+            TAI_PROBE3(frame__flush, 1, frame, decoded.size());
+        }
+    }
+
+    std::vector<unsigned char> frame_payload;    // readFrame scratch, reused across frames
+
+    // Field-split body ("ARIX" with Transform::FieldSplit): delimiter, flags
+    // (bit 0: the input had no trailing newline), column count, then per
+    // column a uint64 length and the column. A column is a coder byte, a
+    // transform byte and a whole-file body of its own, so every column gets
+    // its own symbol table (or adaptive model) and transform choice.
+    // Columns are independent and are coded and decoded in parallel.
+    static std::string encodeColumn(const std::vector<unsigned char>& column, Coder coder) {
+        std::vector<unsigned char> transformed;
+        tai::Transform transform = tai::forwardTransform(column, transformed);
+        const std::vector<unsigned char>& coded = transform == tai::Transform::None ? column : transformed;
+        coder = wholeFileCoder(coder, coded.size());
+        ArithmeticEncoder engine;
+        std::vector<unsigned char> bytes;
+        engine.encodePayload(coded, coder, bytes);
+
+        std::ostringstream out;
+        out.put(static_cast<char>(coder));
+        out.put(static_cast<char>(transform));
+        engine.writeBodyHeader(out, coder, static_cast<uint64_t>(coded.size()));
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        return out.str();
+    }
+
+    static std::string encodeColumns(const tai::FieldSplit::Columns& columns, Coder coder) {
+        std::vector<std::string> bodies(columns.streams.size());
+        tai::parallelFor(bodies.size(), [&](size_t i) {
+            TAI_TRACE_BLOCK(Encode, i);
+            bodies[i] = encodeColumn(columns.streams[i], coder);
+        });
+        std::ostringstream out;
+        out.put(static_cast<char>(columns.delimiter));
+        out.put(columns.trailing_newline ? 0 : 1);
+        out.put(static_cast<char>(bodies.size()));
+        for (const std::string& body : bodies) {
+            writeUint64(out, static_cast<uint64_t>(body.size()));
+            out.write(body.data(), static_cast<std::streamsize>(body.size()));
+        }
+        return out.str();
+    }
+
+    static void readColumns(std::istream& in, std::vector<unsigned char>& decoded) {
+        int delimiter = in.get();
+        int flags = in.get();
+        int count = in.get();
+        if (delimiter < 0 || flags < 0 || flags > 1 || count <= 0) {
+            throw std::runtime_error("Invalid column header");
+        }
+        std::vector<std::string> bodies(static_cast<size_t>(count));
+        for (std::string& body : bodies) {
+            // Grown as data arrives, so a corrupt length cannot force a
+            // huge allocation up front.
+            uint64_t size = readUint64(in);
+            while (body.size() < size) {
+                size_t chunk = static_cast<size_t>(std::min<uint64_t>(size - body.size(), STREAM_BLOCK_SIZE));
+                size_t done = body.size();
+                body.resize(done + chunk);
+                in.read(&body[done], static_cast<std::streamsize>(chunk));
+                if (static_cast<size_t>(in.gcount()) != chunk) throw std::runtime_error("Unexpected EOF");
+            }
+        }
+
+        tai::FieldSplit::Columns columns;
+        columns.delimiter = static_cast<unsigned char>(delimiter);
+        columns.trailing_newline = flags == 0;
+        columns.streams.resize(bodies.size());
+        tai::parallelFor(bodies.size(), [&](size_t i) {
+            TAI_TRACE_BLOCK(Decode, i);
+            std::istringstream column(bodies[i]);
+            int coder_byte = column.get();
+            int transform_byte = column.get();
+            if (coder_byte < 0 || coder_byte > static_cast<int>(Coder::LAST) ||
+                transform_byte < 0 || transform_byte > static_cast<int>(tai::Transform::LAST) ||
+                transform_byte == static_cast<int>(tai::Transform::FieldSplit)) {
+                throw std::runtime_error("Invalid column header");
+            }
+            ArithmeticEncoder engine;
+            engine.readWholeFile(column, static_cast<Coder>(coder_byte), columns.streams[i],
+                                 static_cast<tai::Transform>(transform_byte));
+        });
+        tai::FieldSplit::join(columns, decoded);
+    }
+
+    // Waits for an inline verification started by compress(); on a
+    // mismatch removes the output and throws.
+    static void checkVerified(std::future<std::string>& verified, const std::string& output_file) {
+        std::string error = verified.get();
+        if (!error.empty()) {
+            std::remove(output_file.c_str());
+            throw std::runtime_error("Verification failed at block 0: " + error);
+        }
+    }
+
+    // Writes data coded as the field-split body (from encodeColumns).
+    Statistics compressColumns(const std::vector<unsigned char>& data, const std::string& body,
+                               const std::string& output_file, Coder coder, bool verify_inline) {
+        TAI_PROBE4(block__end, 1, 0, data.size(), body.size() * 8);
+
+        std::future<std::string> verified;
+        if (verify_inline) {
+            verified = std::async(std::launch::async, [&data, &body] {
+                TAI_TRACE_BLOCK(Verify, 0);
+                try {
+                    std::istringstream in(body);
+                    std::vector<unsigned char> decoded;
+                    readColumns(in, decoded);
+                    return decoded == data ? std::string() : std::string("decoded data differs from input");
+                } catch (const std::exception& e) {
+                    return std::string(e.what());
+                }
+            });
+        }
+
+        std::ofstream outfile(output_file, std::ios::binary);
+        if (!outfile) {
+            throw std::runtime_error("Cannot create output file");
+        }
+        {
+            TAI_TRACE_BLOCK(Write, 0);
+            TAI_PROBE1(io__wait__start, 1);
+            outfile.write("ARIX", 4);
+            outfile.put(static_cast<char>(coder));
+            outfile.put(static_cast<char>(tai::Transform::FieldSplit));
+            outfile.write(body.data(), static_cast<std::streamsize>(body.size()));
+            outfile.close();
+            TAI_PROBE2(io__wait__end, 1, body.size());
+        }
+
+        if (verify_inline) checkVerified(verified, output_file);
+        return makeStatistics(static_cast<long long>(data.size()), static_cast<long long>(4 + 2 + body.size()));
+    }
+
+    // --verify-inline for the streaming format: each finished frame is
+    // decoded from its serialized bytes on a pool of worker threads, while
+    // later frames are being encoded, and compared with the input block.
+    // Decoding is slower than encoding, so one worker could not keep up;
+    // frames are independent and spread over up to MAX_WORKERS. At most one
+    // frame per worker plus one waits, which bounds the extra memory.
+    class InlineVerifier {
+    private:
+        struct Job {
+            uint64_t frame;
+            std::vector<unsigned char> block;
+            std::string bytes;
+        };
+        static const unsigned MAX_WORKERS = 8;
+
+        Coder coder;
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<Job> jobs;
+        size_t pending = 0;         // queued or being checked
+        size_t max_pending;
+        bool closing = false;
+        bool failed = false;
+        uint64_t failed_frame = 0;
+        std::string failure;
+        std::vector<std::thread> workers;
+
+        void run() {
+            for (;;) {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [this] { return !jobs.empty() || closing; });
+                    if (jobs.empty()) return;
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+                std::string error = check(job);
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+                // Several workers may fail; report the earliest block.
+                if (!error.empty() && (!failed || job.frame < failed_frame)) {
+                    failed = true;
+                    failed_frame = job.frame;
+                    failure = "Verification failed at block " + std::to_string(job.frame) + ": " + error;
+                }
+                changed.notify_all();
+            }
+        }
+
+        std::string check(const Job& job) {
+            TAI_TRACE_BLOCK(Verify, job.frame);
+            try {
+                ArithmeticEncoder decoder;
+                std::istringstream in(job.bytes);
+                std::vector<unsigned char> decoded;
+                if (!decoder.readFrame(in, coder, decoded, job.frame)) return "empty frame";
+                if (decoded != job.block) return "decoded data differs from input";
+            } catch (const std::exception& e) {
+                return e.what();
+            }
+            return "";
+        }
+
+    public:
+        explicit InlineVerifier(Coder c) : coder(c) {
+            unsigned hw = std::thread::hardware_concurrency();
+            unsigned count = std::max(1u, std::min(MAX_WORKERS, hw > 1 ? hw - 1 : 1u));
+            max_pending = count + 1;
+            for (unsigned i = 0; i < count; i++) {
+                workers.emplace_back([this] { run(); });
+            }
+        }
+
+        ~InlineVerifier() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closing = true;
+            }
+            changed.notify_all();
+            for (std::thread& worker : workers) worker.join();
+        }
+
+        // Queues a frame; waits while the pool is saturated. Throws once any
+        // earlier frame has failed.
+        void submit(uint64_t frame, std::vector<unsigned char> block, std::string bytes) {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this] { return pending < max_pending || failed; });
+            if (failed) throw std::runtime_error(failure);
+            jobs.push_back({frame, std::move(block), std::move(bytes)});
+            pending++;
+            changed.notify_all();
+        }
+
+        // Waits for every queued frame; throws if any failed.
+        void finish() {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this] { return pending == 0; });
+            if (failed) throw std::runtime_error(failure);
+        }
+    };
+
+public:
+    // Input size of one frame in the streaming format: bounds the memory a
+    // filter-mode run needs in each direction.
+    static const size_t STREAM_BLOCK_SIZE = size_t(4) << 20;
+
+    // The classic 32-bit coder needs total_count below 2^30 to stay exact;
+    // whole-file inputs from this size on always use the 64-bit coder.
+    static const uint64_t WIDE_THRESHOLD = uint64_t(1) << 30;
+
+    // Below this size the fixed header (8-byte size, 9 bytes per symbol)
+    // outweighs the payload, so classic whole-file input uses Compact.
+    static const uint64_t SMALL_INPUT = uint64_t(64) << 10;
+
+    // The coder a whole-file body really uses when Classic is asked for.
+    static Coder wholeFileCoder(Coder coder, uint64_t coded_size) {
+        if (coder != Coder::Classic) return coder;
+        if (coded_size >= WIDE_THRESHOLD) return Coder::Wide;
+        if (coded_size < SMALL_INPUT) return Coder::Compact;
+        return coder;
+    }
+
+    // Decoded size at the start of a whole-file body (uint64, or a varint
+    // for Compact and Split).
+    static uint64_t readBodySize(std::istream& in, Coder coder) {
+        return coder == Coder::Compact || coder == Coder::Split ? readVarint(in) : readUint64(in);
+    }
+
+    // Whole-file formats: "ARIT" (classic), "ARIW" (wide), "ARIQ" (adaptive),
+    // "ARIM" (context mixing), "ARIC" (compact), "ARIB" (split into blocks),
+    // and "ARIX" coder transform for preprocessed data (see transform.h).
+    // Classic input of WIDE_THRESHOLD bytes or more is coded with Wide, and
+    // input under SMALL_INPUT with Compact.
+    // verify_inline decodes the payload again while the output is written
+    // and removes the output and throws if it does not match the input.
+    // preprocess runs the input through forwardTransform first, or, for
+    // delimited lines whose columns are estimated to code smaller apart,
+    // through FieldSplit into per-column streams (see encodeColumns); it is
+    // stored untransformed when no transform pays off.
+    Statistics compress(const std::string& input_file, const std::string& output_file,
+                        Coder coder = Coder::Classic, bool verify_inline = false,
+                        bool preprocess = false) {
+        // Read input file
+        std::ifstream infile(input_file, std::ios::binary);
+        if (!infile) {
+            throw std::runtime_error("Cannot open input file");
+        }
+        
+        std::vector<unsigned char> data;
+        {
+            TAI_TRACE_BLOCK(Read, 0);
+            TAI_PROBE1(io__wait__start, 0);
+            data.assign(std::istreambuf_iterator<char>(infile), std::istreambuf_iterator<char>());
+            TAI_PROBE2(io__wait__end, 0, data.size());
+        }
+        infile.close();
+        
+        long long original_size = data.size();
+        TAI_PROBE3(block__start, 1, 0, data.size());
+        
+        tai::Transform transform = tai::Transform::None;
+        std::vector<unsigned char> transformed;
+        if (preprocess) {
+            transform = tai::forwardTransform(data, transformed);
+            unsigned char delimiter;
+            if (size_t count = tai::FieldSplit::detect(data, delimiter)) {
+                // Each column picks its own transform, which an order-0
+                // estimate of the raw columns cannot see: code them and
+                // compare with the single-stream estimate.
+                std::string body = encodeColumns(tai::FieldSplit::split(data, delimiter, count), coder);
+                uint64_t flat_cost = tai::storedCostBits(transform == tai::Transform::None ? data : transformed);
+                if (body.size() * 8 < flat_cost) {
+                    return compressColumns(data, body, output_file, coder, verify_inline);
+                }
+            }
+        }
+        const std::vector<unsigned char>& coded = transform == tai::Transform::None ? data : transformed;
+
+        // Encode
+        coder = wholeFileCoder(coder, coded.size());
+        BitWriter writer;
+        {
+            TAI_TRACE_BLOCK(Encode, 0);
+            encodePayload(coded, coder, writer.bytes);
+        }
+        TAI_PROBE4(block__end, 1, 0, data.size(), writer.bytes.size() * 8);
+
+        // Format and body header, as written before the payload
+        std::ostringstream header_out;
+        static const char* const magic[] = {"ARIT", "ARIW", "ARIQ", "ARIM", "ARIC", "ARIB"};
+        if (transform == tai::Transform::None) {
+            header_out.write(magic[static_cast<int>(coder)], 4);
+        } else {
+            header_out.write("ARIX", 4);
+            header_out.put(static_cast<char>(coder));
+            header_out.put(static_cast<char>(transform));
+        }
+        writeBodyHeader(header_out, coder, static_cast<uint64_t>(coded.size()));
+        const std::string header = header_out.str();
+
+        // Verification parses the file bytes from scratch, like
+        // InlineVerifier does with frames, so the header is checked too.
+        std::future<std::string> verified;
+        if (verify_inline) {
+            verified = std::async(std::launch::async, [&data, &header, &writer] {
+                TAI_TRACE_BLOCK(Verify, 0);
+                try {
+                    std::string file = header;
+                    file.append(reinterpret_cast<const char*>(writer.bytes.data()), writer.bytes.size());
+                    std::istringstream in(file);
+                    Coder parsed_coder;
+                    tai::Transform parsed_transform;
+                    if (readFormat(in, parsed_coder, parsed_transform)) return std::string("not a whole-file format");
+                    ArithmeticEncoder decoder;
+                    std::vector<unsigned char> decoded;
+                    decoder.readWholeFile(in, parsed_coder, decoded, parsed_transform);
+                    return decoded == data ? std::string() : std::string("decoded data differs from input");
+                } catch (const std::exception& e) {
+                    return std::string(e.what());
+                }
+            });
+        }
+        
+        // Write output file
+        std::ofstream outfile(output_file, std::ios::binary);
+        if (!outfile) {
+            throw std::runtime_error("Cannot create output file");
+        }
+        {
+            TAI_TRACE_BLOCK(Write, 0);
+            TAI_PROBE1(io__wait__start, 1);
+            outfile.write(header.data(), static_cast<std::streamsize>(header.size()));
+            outfile.write(reinterpret_cast<const char*>(writer.bytes.data()), writer.bytes.size());
+            outfile.close();
+            TAI_PROBE2(io__wait__end, 1, writer.bytes.size());
+        }
+
+        if (verify_inline) checkVerified(verified, output_file);
+        
+        long long compressed_size = static_cast<long long>(header.size() + writer.bytes.size());
+        
+        return makeStatistics(original_size, compressed_size);
+    }
+
+    // Streaming ("ARIS") format for pipes: the input is cut into frames of
+    // STREAM_BLOCK_SIZE bytes, each with its own table and CRC-32C:
+    //   "ARIS" coder { raw_size crc32c symbol_table payload_size payload }* 0
+    // where coder is a Coder value; Compact frames are coded as Classic,
+    // with the fixed table. Adaptive and context-mixing frames carry
+    // an empty symbol table and start from a fresh model; split frames carry
+    // an empty one too and are split on their own. With verify_inline every frame is
+    // decoded and compared on a second thread (InlineVerifier); on a
+    // mismatch this throws before the end marker is written, so the output
+    // cannot pass for a complete stream.
+    Statistics compressStream(std::istream& in, std::ostream& out, Coder coder = Coder::Classic,
+                              bool verify_inline = false) {
+        std::unique_ptr<InlineVerifier> verifier;
+        if (verify_inline) verifier.reset(new InlineVerifier(coder));
+        writeStreamHeader(out, coder);
+        long long original_size = 0;
+        long long compressed_size = 4 + 1 + 4;
+        std::vector<unsigned char> block;
+        for (uint64_t frame = 0; readBlock(in, block, STREAM_BLOCK_SIZE, frame) > 0; frame++) {
+            original_size += static_cast<long long>(block.size());
+            if (!verifier) {
+                compressed_size += static_cast<long long>(writeFrame(out, block, coder, frame));
+                continue;
+            }
+            std::ostringstream frame_out;
+            compressed_size += static_cast<long long>(writeFrame(frame_out, block, coder, frame));
+            std::string bytes = frame_out.str();
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            if (!out) throw std::runtime_error("Write error");
+            verifier->submit(frame, std::move(block), std::move(bytes));
+            block = std::vector<unsigned char>();
+        }
+        if (verifier) verifier->finish();
+        writeStreamEnd(out);
+        out.flush();
+        return makeStatistics(original_size, compressed_size);
+    }
+
+    // Frame-level access to the streaming format for callers that drive
+    // their own I/O (compressed_streambuf.h): writeStreamHeader, any number
+    // of writeFrame calls, then writeStreamEnd.
+    void writeStreamHeader(std::ostream& out, Coder coder) {
+        out.write("ARIS", 4);
+        out.put(static_cast<char>(coder));
+    }
+
+    // Codes block (1 to 2^32 - 1 bytes) as one frame; returns the bytes written.
+    size_t writeFrame(std::ostream& out, const std::vector<unsigned char>& block, Coder coder,
+                      uint64_t frame = 0) {
+        TAI_PROBE3(block__start, 1, frame, block.size());
+        BitWriter writer;
+        {
+            TAI_TRACE_BLOCK(Encode, frame);
+            encodePayload(block, coder, writer.bytes);
+        }
+        TAI_PROBE4(block__end, 1, frame, block.size(), writer.bytes.size() * 8);
+
+        {
+            TAI_TRACE_BLOCK(Write, frame);
+            TAI_PROBE1(io__wait__start, 1);
+            writeUint32(out, static_cast<uint32_t>(block.size()));
+            writeUint32(out, tai::crc32c(0, block.data(), block.size()));
+            writeSymbolTable(out);
+            writeUint32(out, static_cast<uint32_t>(writer.bytes.size()));
+            out.write(reinterpret_cast<const char*>(writer.bytes.data()), writer.bytes.size());
+            TAI_PROBE2(io__wait__end, 1, writer.bytes.size());
+        }
+        if (!out) throw std::runtime_error("Write error");
+        TAI_PROBE3(frame__flush, 1, frame, writer.bytes.size());
+        return 4 + 4 + symbolTableSize(symbols.size()) + 4 + writer.bytes.size();
+    }
+
+    void writeStreamEnd(std::ostream& out) {
+        writeUint32(out, 0);
+    }
+
+    // Reads the format header. Returns true for the streaming format, false
+    // for a whole-file format; coder and transform are set either way.
+    static bool readFormat(std::istream& in, Coder& coder, tai::Transform& transform) {
+        char magic[4];
+        in.read(magic, 4);
+        std::string format(magic, static_cast<size_t>(in.gcount()));
+        transform = tai::Transform::None;
+        if (format == "ARIX") {
+            int coder_byte = in.get();
+            int transform_byte = in.get();
+            if (coder_byte < 0 || coder_byte > static_cast<int>(Coder::LAST) ||
+                transform_byte <= 0 || transform_byte > static_cast<int>(tai::Transform::LAST)) {
+                throw std::runtime_error("Invalid file header");
+            }
+            coder = static_cast<Coder>(coder_byte);
+            transform = static_cast<tai::Transform>(transform_byte);
+        } else if (format == "ARIT") {
+            coder = Coder::Classic;
+        } else if (format == "ARIW") {
+            coder = Coder::Wide;
+        } else if (format == "ARIQ") {
+            coder = Coder::Adaptive;
+        } else if (format == "ARIM") {
+            coder = Coder::ContextMix;
+        } else if (format == "ARIC") {
+            coder = Coder::Compact;
+        } else if (format == "ARIB") {
+            coder = Coder::Split;
+        } else if (format == "ARIS") {
+            int coder_byte = in.get();
+            if (coder_byte < 0 || coder_byte > static_cast<int>(Coder::LAST)) {
+                throw std::runtime_error("Invalid stream header");
+            }
+            coder = static_cast<Coder>(coder_byte);
+            return true;
+        } else {
+            throw std::runtime_error("Invalid file format");
+        }
+        return false;
+    }
+
+    // Decodes the next frame into decoded (replacing its contents) and
+    // checks its CRC; returns false at the end-of-stream marker.
+    bool readFrame(std::istream& in, Coder coder, std::vector<unsigned char>& decoded,
+                   uint64_t frame = 0) {
+        decoded.clear();
+        uint32_t raw_size = readUint32(in);
+        if (raw_size == 0) return false;
+        uint32_t crc = readUint32(in);
+        readSymbolTable(in);
+        uint32_t payload_size = readUint32(in);
+        if (readBlock(in, frame_payload, payload_size, frame) != payload_size) {
+            throw std::runtime_error("Unexpected EOF");
+        }
+
+        decoded.reserve(raw_size);
+        TAI_PROBE3(block__start, 1, frame, payload_size);
+        {
+            TAI_TRACE_BLOCK(Decode, frame);
+            decodePayload(frame_payload, coder, decoded, raw_size);
+        }
+        TAI_PROBE4(block__end, 1, frame, payload_size, decoded.size() * 8);
+        if (tai::crc32c(0, decoded.data(), decoded.size()) != crc) {
+            throw std::runtime_error("Checksum mismatch");
+        }
+        return true;
+    }
+
+    // Reads a frame header and seeks past its payload without decoding it;
+    // returns the frame's decoded size, 0 at the end-of-stream marker.
+    static uint32_t skipFrame(std::istream& in) {
+        uint32_t raw_size = readUint32(in);
+        if (raw_size == 0) return 0;
+        readUint32(in);
+        uint32_t symbol_count = readUint32(in);
+        if (symbol_count > 256) throw std::runtime_error("Invalid symbol table");
+        in.seekg(static_cast<std::streamoff>(symbol_count) * (1 + 8), std::ios::cur);
+        uint32_t payload_size = readUint32(in);
+        in.seekg(payload_size, std::ios::cur);
+        if (!in) throw std::runtime_error("Unexpected EOF");
+        return raw_size;
+    }
+
+    // Decodes the rest of a whole-file format (after readFormat) into decoded.
+    // "ARIT"/"ARIW": coded size, symbol table, payload. "ARIQ" (adaptive),
+    // "ARIM" (context mixing) and "ARIB" (tables inside the blocks of its
+    // payload, see encodeDataSplit) have no symbol table. "ARIC" has both in
+    // compact form (writeBodyHeader). "ARIX" is one of those bodies holding the output
+    // of transform, which is undone here, or a field-split column set.
+    void readWholeFile(std::istream& in, Coder coder, std::vector<unsigned char>& decoded,
+                       tai::Transform transform = tai::Transform::None) {
+        if (transform == tai::Transform::FieldSplit) {
+            readColumns(in, decoded);
+            return;
+        }
+        uint64_t original_size = readBodyHeader(in, coder);
+
+        std::vector<unsigned char> bitstream;
+        {
+            TAI_TRACE_BLOCK(Read, 0);
+            bitstream.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+
+        decoded.clear();
+        decoded.reserve(static_cast<size_t>(original_size));
+        TAI_PROBE3(block__start, 1, 0, bitstream.size());
+        {
+            TAI_TRACE_BLOCK(Decode, 0);
+            decodePayload(bitstream, coder, decoded, original_size);
+        }
+        TAI_PROBE4(block__end, 1, 0, bitstream.size(), decoded.size() * 8);
+        if (transform != tai::Transform::None) {
+            std::vector<unsigned char> restored;
+            tai::inverseTransform(transform, decoded, restored);
+            decoded.swap(restored);
+        }
+    }
+
+    void decompress(const std::string& input_file, const std::string& output_file) {
+        std::ifstream infile(input_file, std::ios::binary);
+        if (!infile) {
+            throw std::runtime_error("Cannot open input file");
+        }
+        std::ofstream outfile(output_file, std::ios::binary);
+        if (!outfile) {
+            throw std::runtime_error("Cannot create output file");
+        }
+        decompress(infile, outfile);
+    }
+
+    // Accepts every whole-file format and the streaming ("ARIS") format.
+    void decompress(std::istream& in, std::ostream& out) {
+        Coder coder;
+        tai::Transform transform;
+        if (readFormat(in, coder, transform)) {
+            decompressFrames(in, out, coder);
+        } else {
+            decompressWholeFile(in, out, coder, transform);
+        }
+        out.flush();
+    }
+
+    void printStatistics(const Statistics& stats, std::ostream& os = std::cout) {
+        os << "\n=== Compression Statistics ===" << std::endl;
+        os << "Original size:     " << stats.original_size << " bytes" << std::endl;
+        os << "Compressed size:   " << stats.compressed_size << " bytes" << std::endl;
+        os << "Compression ratio: " << std::fixed << std::setprecision(4) 
+           << stats.compression_ratio * 100 << "%" << std::endl;
+        os << "Space saved:       " << stats.space_saved << " bytes ("
+           << std::fixed << std::setprecision(2) 
+           << (1 - stats.compression_ratio) * 100 << "%)" << std::endl;
+    }
+};
+
+#endif
@@ -0,0 +1,954 @@
+#ifndef TAI_CODER_ARITHMETIC_ENCODER_2_H
+#define TAI_CODER_ARITHMETIC_ENCODER_2_H
+
+// Encoder 2: adaptive arithmetic coder with a per-block rate search, in
+// whole-file, stream (-c) and parallel segment (-j) formats, plus the E8/E9
+// filter for x86 code. The command-line tool is arithmetic_encoder_2.cpp.
+
+#include <stdlib.h>
+#include <cstdio>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <string.h>
+#include <algorithm>
+
+#include "../common/parallel.h"
+#include "../common/phase.h"
+#include "../common/probes.h"
+#include "../common/trace.h"
+#include "../transform/x86_branch.h"
+
+//
+class Fileread {
+private:
+    struct byte {
+        unsigned char b;
+        int len;
+    };
+    FILE *f;
+    std::string filename, filetype;
+    byte br;
+    int filesize;
+    const unsigned char *mem = NULL;
+    size_t mem_size = 0, mem_pos = 0;
+    size_t rawread(void *dst, size_t size, size_t count) {
+        if (mem == NULL)
+            return fread(dst, size, count, f);
+        size_t n = std::min(count, (mem_size - mem_pos) / size);
+        memcpy(dst, mem + mem_pos, n * size);
+        mem_pos += n * size;
+        return n;
+    }
+    static FILE *open_file(const std::string &s, const std::string &type) {
+        if (s == "-")
+            return stdin;
+        return fopen(s.c_str(), type.c_str());
+    }
+    int calc_filesize() {
+        int n = 0, ans = 0;
+        const int TMPBUFSZ = 512;
+        char *tmpbuf = new char[TMPBUFSZ];
+        while (n = fread(tmpbuf, 1, TMPBUFSZ, f)) {
+            ans += n;
+        }
+        fseek(f, 0, SEEK_SET);
+        delete[] tmpbuf;
+        return ans;
+    }
+public:
+    Fileread(std::string s, std::string type) : br{ 0, 0 }, filesize(-1) {
+        filename = s;
+        filetype = type;
+        f = open_file(s, type);
+        if (f == NULL) {
+            std::cerr << "error in opening file" << std::endl;
+            exit(1);
+        }
+    }
+    Fileread(char *s, char *type) : br{ 0, 0 }, filesize(-1) {
+        filename = s;
+        filetype = type;
+        f = fopen(s, type);
+        if (f == NULL) {
+            std::cerr << "error in opening file" << std::endl;
+            exit(1);
+        }
+    }
+    //reads from a memory buffer instead of a file (a chunk of a stream)
+    Fileread(const unsigned char *data, size_t size) : f(NULL), br{ 0, 0 }, filesize((int)size), mem(data), mem_size(size) {}
+    Fileread() {}
+    int get_filesize() {
+        if (filesize == -1)
+            filesize = calc_filesize();
+        return filesize;
+    }
+    int read(unsigned char *buf, int len) {
+        return rawread(buf, 1, len);
+    }
+    int read(int *x) {
+        return rawread(x, sizeof(*x), 1);
+    }
+    int read(long long *x) {
+        return rawread(x, sizeof(*x), 1);
+    }
+    int bread(int *a) {
+        int ans = 0;
+        if (br.len == 0) {
+            if (rawread(&br.b, 1, 1) != 1) {
+                return 0;
+            }
+            br.len = 8;
+        }
+        br.len--;
+        ans <<= 1;
+        ans |= br.b & 1;
+        br.b >>= 1;
+        *a = ans;
+        return 1;
+    }
+    void fflush() {
+        br.len = 0;
+    }
+    int bread(int *a, int n) {
+        *a = 0;
+        for (int i = 0; i < n; i++) {
+            int bit_r;
+            if (!bread(&bit_r))
+                return 0;
+            *a |= bit_r * (1 << i);
+        }
+        return 1;
+    }
+    //0 on success, like fseek; pipes cannot seek (see buffer_rest)
+    int seek(long offset, int mode) {
+        if (mem == NULL)
+            return fseek(f, offset, mode);
+        long base = mode == SEEK_SET ? 0 : mode == SEEK_CUR ? (long)mem_pos : (long)mem_size;
+        if (base + offset < 0 || base + offset > (long)mem_size)
+            return -1;
+        mem_pos = base + offset;
+        return 0;
+    }
+    bool seekable() {
+        return mem != NULL || fseek(f, 0, SEEK_CUR) == 0;
+    }
+    //reads the rest of the file into data and reads from there on; the
+    //consumed bytes already read stay in front (zeroed), so offsets are
+    //still those of the file
+    void buffer_rest(std::vector<unsigned char> &data, size_t consumed) {
+        data.assign(consumed, 0);
+        unsigned char chunk[1 << 16];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+            data.insert(data.end(), chunk, chunk + n);
+        }
+        mem = data.data();
+        mem_size = data.size();
+        mem_pos = consumed;
+    }
+    void operator=(const Fileread &copy) {
+        f = open_file(copy.filename, copy.filetype);
+        filesize = copy.filesize;
+        filename = copy.filename;
+        filetype = copy.filetype;
+        br = copy.br;
+    }
+};
+
+class Filewrite {
+private:
+    struct byte {
+        unsigned char b;
+        int len;
+    };
+    FILE *f;
+    byte bw;
+    std::string filename, filetype;
+    long long filesize;
+    std::vector<unsigned char> *mem = NULL;
+    void rawwrite(const void *src, size_t size) {
+        if (mem == NULL) {
+            fwrite(src, size, 1, f);
+            return;
+        }
+        const unsigned char *p = (const unsigned char *)src;
+        mem->insert(mem->end(), p, p + size);
+    }
+    static FILE *open_file(const std::string &s, const std::string &type) {
+        if (s == "-")
+            return stdout;
+        return fopen(s.c_str(), type.c_str());
+    }
+public:
+    Filewrite(std::string s, std::string type) : bw{ 0, 0 }, filesize(0) {
+        filename = s;
+        filetype = type;
+        f = open_file(s, type);
+        if (f == NULL) {
+            std::cerr << "error in opening file" << std::endl;
+            exit(1);
+        }
+    }
+    Filewrite(char *s, char *type) : bw{ 0, 0 }, filesize(0) {
+        filename = s;
+        filetype = type;
+        f = fopen(s, type);
+        if (f == NULL) {
+            std::cerr << "error in opening file" << std::endl;
+            exit(1);
+        }
+    }
+    //collects the output in a memory buffer instead of a file
+    Filewrite(std::vector<unsigned char> *out) : f(NULL), bw{ 0, 0 }, filesize(0), mem(out) {}
+    ~Filewrite() {
+        if (f == stdout)
+            fflush(f);
+        else if (f != NULL)
+            fclose(f);
+    }
+    void writebite(int bit) {
+        filesize++;
+        if (bit == -1) { //flush a partial byte; an empty one would shift the agres trailer
+            if (bw.len > 0)
+                rawwrite(&bw.b, 1);
+            bw.len = 0;
+            bw.b = 0;
+        }
+        else {
+            bw.b |= bit << (bw.len++);
+            if (bw.len == 8) {
+                rawwrite(&bw.b, 1);
+                bw.len = 0;
+                bw.b = 0;
+            }
+        }
+    }
+    void write(unsigned char x) {
+        rawwrite(&x, sizeof(x));
+    }
+    void write(int x) {
+        rawwrite(&x, sizeof(x));
+    }
+    void write(const unsigned char *buf, int len) {
+        rawwrite(buf, len);
+    }
+    long long bits_written() const {
+        return filesize;
+    }
+    Filewrite() : f(NULL), bw{ 0, 0 }, filesize(0) {}
+    void operator=(const Filewrite &copy) {
+        f = open_file(copy.filename, copy.filetype);
+        filesize = copy.filesize;
+        filename = copy.filename;
+        filetype = copy.filetype;
+        bw = copy.bw;
+    }
+};
+
+class Probability {
+private:
+    static const int CHARSIZ = 256;
+    int add, del, overflo;
+    //in the object itself: copies in findbest cost no allocation
+    int p[CHARSIZ + 1], psum[CHARSIZ + 1];
+public:
+    Probability(int add = 1000, int del = 3000, int overflo = 3000) : add(add), del(del), overflo(overflo) {
+        p[0] = 1;
+        psum[0] = 0;
+        for (int i = 1; i <= CHARSIZ; i++) {
+            p[i] = 1;
+            psum[i] = psum[i - 1] + p[i];
+        }
+    }
+    void check_overflow() {
+        if (psum[CHARSIZ] > overflo) {
+            TAI_PROBE1(model__rescale, psum[CHARSIZ]);
+            for (int i = 1; i <= CHARSIZ; i++) { //Нулевой символ занулить
+                p[i] /= del;
+                if (p[i] == 0) {
+                    p[i] = 1;
+                }
+                psum[i] = psum[i - 1] + p[i];
+            }
+        }
+    }
+    void inc(int i) {
+        TAI_PHASE(ProbabilityInc);
+        p[i] += add;
+        for (int q = i; q <= CHARSIZ; q++) {
+            psum[q] = psum[q - 1] + p[q];
+        }
+        check_overflow();
+    }
+    void get_borders(long long &lnew, long long &rnew, int i) {
+        long long l = lnew, r = rnew;
+        long long len = (r - l + 1);
+        lnew = l + len * psum[i - 1] / psum[CHARSIZ];
+        rnew = l + len * psum[i] / psum[CHARSIZ] - 1;
+    }
+    void set_add(int add_) {
+        add = add_;
+    }
+    //order-0 summary used to prime a segment's model (parallel format): a
+    //4-bit log2 weight per byte value, two values per byte. The weights add
+    //up to at most PRIME_TOTAL + CHARSIZ, well under overflo, so the first
+    //rescale does not wipe them out
+    static const int SUMMARY_BYTES = 128;
+    static const int PRIME_TOTAL = 1024;
+    static void summarize(const unsigned char data[], size_t n, unsigned char summary[]) {
+        long long counts[CHARSIZ] = {0};
+        for (size_t i = 0; i < n; i++) {
+            counts[data[i]]++;
+        }
+        memset(summary, 0, SUMMARY_BYTES);
+        for (int v = 0; v < CHARSIZ && n > 0; v++) {
+            long long w = counts[v] * PRIME_TOTAL / (long long)n;
+            int level = 0;
+            while (w) {
+                level++;
+                w >>= 1;
+            }
+            summary[v >> 1] |= level << ((v & 1) * 4);
+        }
+    }
+    void prime(const unsigned char summary[]) {
+        for (int i = 1; i <= CHARSIZ; i++) {
+            int level = (summary[(i - 1) >> 1] >> (((i - 1) & 1) * 4)) & 15;
+            p[i] = 1 + (level ? 1 << (level - 1) : 0);
+            psum[i] = psum[i - 1] + p[i];
+        }
+    }
+};
+
+class Compressor {
+private:
+    const long long LEN, MAX;
+    long long l, r, qtr1, qtr2, qtr3, half, bufsize;
+    int bits_to_folow = 0;
+    unsigned char *buf;
+    std::vector<int> agres;
+    Probability prob;
+    Fileread fr;
+    Filewrite fw;
+    bool stream;
+    long long blocks = 0;
+    //files under SMALL_INPUT bytes skip the rate search: its trial runs cost
+    //more than the few bytes it saves there, so every block uses SMALL_RATE
+    static const int SMALL_INPUT = 4096;
+    static const int SMALL_RATE = 2;
+    bool small = false;
+    //parallel format (-j), for files larger than one segment
+    unsigned threads;
+    bool parallel = false;
+    //input goes through staged: [staged_pos, staged_done) is ready to code,
+    //the rest still waits for the E8/E9 filter (x86) when it is on
+    static const int STAGE_READ = 1 << 16;
+    static const int DETECT_BYTES = 1 << 20;
+    std::vector<unsigned char> staged;
+    size_t staged_pos = 0, staged_done = 0;
+    bool input_eof = false, x86 = false;
+    tai::X86BranchFilter filter;
+    void fill_staged(size_t want) {
+        while (staged_done - staged_pos < want && !input_eof) {
+            staged.erase(staged.begin(), staged.begin() + staged_pos);
+            staged_done -= staged_pos;
+            staged_pos = 0;
+            size_t old = staged.size();
+            staged.resize(old + STAGE_READ);
+            int n;
+            {
+                TAI_TRACE(Read);
+                TAI_PROBE1(io__wait__start, 0);
+                n = fr.read(staged.data() + old, STAGE_READ);
+                TAI_PROBE2(io__wait__end, 0, n);
+            }
+            staged.resize(old + n);
+            input_eof = n == 0;
+            if (x86) {
+                staged_done += filter.encode(staged.data() + staged_done, staged.size() - staged_done, input_eof);
+            } else {
+                staged_done = staged.size();
+            }
+        }
+    }
+    int read_input(unsigned char *dst, int len) {
+        fill_staged(len);
+        int n = (int)std::min((size_t)len, staged_done - staged_pos);
+        memcpy(dst, staged.data() + staged_pos, n);
+        staged_pos += n;
+        return n;
+    }
+    //x86 code (tai::X86BranchFilter::detect on the first DETECT_BYTES) is
+    //filtered; such files start with -2 in front of the usual header
+    void write_header() {
+        int filesize = stream ? -1 : fr.get_filesize();
+        small = !stream && filesize < SMALL_INPUT;
+        parallel = threads > 0 && !stream && filesize > SEGMENT_SIZE;
+        fill_staged(DETECT_BYTES);
+        if (tai::X86BranchFilter::detect(staged.data(), staged.size())) {
+            x86 = true;
+            staged_done = filter.encode(staged.data(), staged.size(), input_eof);
+            fw.write(-2);
+        }
+        if (parallel) {
+            fw.write(-3);
+        }
+        fw.write(filesize);
+    }
+    void addbits(Filewrite &out, int &bits_to_folow, int last) {
+        for (int i = 0; i < bits_to_folow; i++) {
+            out.writebite(!last);
+        }
+        bits_to_folow = 0;
+    }
+    long long check(int n, const unsigned char buf[], long long l, long long r, long long add, Probability &prob) {
+        long long half = (MAX + 1) >> 1, qtr1 = half >> 1, qtr3 = qtr1 * 3;
+        long long size = 0;
+        prob.set_add(add);
+        for (int i = 0; i < n; i++) {
+            int j = buf[i] + 1;
+            prob.get_borders(l, r, j);
+            while (1) {
+                if (r < half) {
+                    size++;
+                }
+                else if (l >= half) {
+                    size++;
+                    l -= half;
+                    r -= half;
+                }
+                else if (l >= qtr1 && r < qtr3) {
+                    l -= qtr1;
+                    r -= qtr1;
+                    size++;
+                }
+                else break;
+                l += l;
+                r += r + 1;
+            }
+            prob.inc(j);
+        }
+        return size;
+    }
+    long long findbest(const unsigned char buf[], long long l, long long r, long long n, const Probability &prob) {
+        TAI_PHASE(FindBest);
+        TAI_TRACE(RateSearch);
+        Probability checkprob;
+        long long size = 0, add = -1, minsize, fl = 1, last, sign, min_st;
+        for (long long i = 1, st = 0; i <= 4294967296; i *= 2, st++) {
+            checkprob = prob;
+            long long size = check(n, buf, l, r, i, checkprob);
+            if (i == 4) {
+                if (last > size) {
+                    sign = 1;
+                }
+                else {
+                    sign = -1;
+                }
+            }
+            if (i > 4) {
+                if (sign * (last - size) < 0) {
+                    break;
+                }
+            }
+            if (add == -1 || size < minsize) {
+                add = i;
+                min_st = st;
+                minsize = size;
+            }
+            last = size;
+        }
+        return min_st;
+    }
+    void get_agr() {
+        Fileread f = fr;
+        int n;
+        while (n = f.read(buf, bufsize)) {
+            Probability prob;
+        }
+    }
+    void encode_block(const unsigned char buf[], int n, Filewrite &out) {
+        [[maybe_unused]] long long bits_before = out.bits_written(); //probe argument only
+        TAI_TRACE_BLOCK(Encode, blocks);
+        TAI_PROBE3(block__start, 2, blocks, n);
+        int min_st = SMALL_RATE;
+        if (!small) {
+            TAI_PROBE2(findbest__start, blocks, n);
+            min_st = findbest(buf, 0, MAX, n, prob);
+            TAI_PROBE2(findbest__end, blocks, min_st);
+        }
+        agres.push_back(min_st);
+        prob.set_add(1 << min_st);
+        TAI_PHASE(EncodeData);
+        for (int i = 0; i < n; i++) {
+            int j = buf[i] + 1;
+            prob.get_borders(l, r, j);
+            while (1) {
+                if (r < half) {
+                    out.writebite(0);
+                    addbits(out, bits_to_folow, 0);
+                }
+                else if (l >= half) {
+                    out.writebite(1);
+                    addbits(out, bits_to_folow, 1);
+                    l -= half;
+                    r -= half;
+                }
+                else if (l >= qtr1 && r < qtr3) {
+                    l -= qtr1;
+                    r -= qtr1;
+                    bits_to_folow++;
+                }
+                else break;
+                l += l;
+                r += r + 1;
+            }
+            prob.inc(j);
+        }
+        TAI_PROBE4(block__end, 2, blocks, n, out.bits_written() - bits_before);
+        blocks++;
+    }
+    //two bits pick a quarter inside [l, r], so whatever the decoder reads
+    //after them (the agres trailer, padding) cannot move its value out
+    void finish(Filewrite &out) {
+        bits_to_folow++;
+        if (l < qtr1) {
+            out.writebite(0);
+            addbits(out, bits_to_folow, 0);
+        }
+        else {
+            out.writebite(1);
+            addbits(out, bits_to_folow, 1);
+        }
+        out.writebite(-1);
+        l = 0;
+        r = MAX;
+    }
+    void write_agres(Filewrite &out) {
+        for (int i = 0; i < agres.size(); i++) {
+            for (int j = 0; j < 5; j++) {
+                out.writebite(agres[i] & 1);
+                agres[i] >>= 1;
+            }
+        }
+        out.writebite(-1);
+        agres.clear();
+    }
+    //stream format (no seeks, bounded memory): header -1 instead of the file size,
+    //then chunks {int n, int payload size, agres bits, coded bits} ended by n = 0.
+    //The coder is flushed at every chunk end, the model carries over.
+    void compress_stream() {
+        const int chunksize = bufsize * STREAM_CHUNK_BLOCKS;
+        unsigned char *chunk = new unsigned char[chunksize];
+        std::vector<unsigned char> bits, agr;
+        int n;
+        long long frame = 0;
+        while ((n = read_input(chunk, chunksize)) > 0) {
+            long long first = blocks;
+            bits.clear();
+            agr.clear();
+            Filewrite bw(&bits), aw(&agr);
+            for (int i = 0; i < n; i += bufsize) {
+                encode_block(chunk + i, std::min((int)bufsize, n - i), bw);
+            }
+            finish(bw);
+            write_agres(aw);
+            TAI_TRACE_BLOCK(Write, first);
+            TAI_PROBE1(io__wait__start, 1);
+            fw.write(n);
+            fw.write((int)(agr.size() + bits.size()));
+            fw.write(agr.data(), agr.size());
+            fw.write(bits.data(), bits.size());
+            TAI_PROBE2(io__wait__end, 1, agr.size() + bits.size());
+            TAI_PROBE3(frame__flush, 2, frame, agr.size() + bits.size());
+            frame++;
+        }
+        fw.write(0);
+        delete[] chunk;
+    }
+    //codes one segment of the parallel format with a fresh coder and the
+    //given model; the payload is laid out like a stream chunk's
+    void encode_segment(const unsigned char data[], int n, const Probability &primed,
+                        std::vector<unsigned char> &agr, std::vector<unsigned char> &bits) {
+        prob = primed;
+        Filewrite bw(&bits), aw(&agr);
+        for (int i = 0; i < n; i += bufsize) {
+            encode_block(data + i, std::min((int)bufsize, n - i), bw);
+        }
+        finish(bw);
+        write_agres(aw);
+    }
+    //parallel format: header -3 in front of the file size, then the segment
+    //size and per segment of SEGMENT_SIZE input bytes {summary, int payload
+    //size, agres bits, coded bits}. Segments are coded independently on up
+    //to threads workers, each model primed from the order-0 summary of the
+    //last PRIME_WINDOW bytes of the segment before (the model is windowed by
+    //its rescaling, so that is close to what a sequential run would hold
+    //there). The output does not depend on the number of threads
+    void compress_parallel() {
+        std::vector<unsigned char> data;
+        int n;
+        do {
+            size_t old = data.size();
+            data.resize(old + STAGE_READ);
+            n = read_input(data.data() + old, STAGE_READ);
+            data.resize(old + n);
+        } while (n > 0);
+        size_t segments = (data.size() + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+        std::vector<std::vector<unsigned char>> summaries(segments, std::vector<unsigned char>(Probability::SUMMARY_BYTES));
+        std::vector<std::vector<unsigned char>> agrs(segments), bits(segments);
+        tai::parallelFor(segments, [&](size_t i) {
+            size_t begin = i * SEGMENT_SIZE;
+            Probability primed;
+            if (i > 0) {
+                size_t window = std::min((size_t)PRIME_WINDOW, begin);
+                Probability::summarize(data.data() + begin - window, window, summaries[i].data());
+                primed.prime(summaries[i].data());
+            }
+            Compressor segment(LEN, bufsize);
+            segment.blocks = begin / bufsize;
+            segment.encode_segment(data.data() + begin, (int)std::min((size_t)SEGMENT_SIZE, data.size() - begin),
+                                   primed, agrs[i], bits[i]);
+        }, threads == ALL_THREADS ? 0 : threads);
+        TAI_TRACE(Write);
+        TAI_PROBE1(io__wait__start, 1);
+        fw.write(SEGMENT_SIZE);
+        for (size_t i = 0; i < segments; i++) {
+            fw.write(summaries[i].data(), Probability::SUMMARY_BYTES);
+            fw.write((int)(agrs[i].size() + bits[i].size()));
+            fw.write(agrs[i].data(), agrs[i].size());
+            fw.write(bits[i].data(), bits[i].size());
+        }
+        TAI_PROBE2(io__wait__end, 1, data.size());
+    }
+public:
+    static const int STREAM_CHUNK_BLOCKS = 2048;
+    static const int SEGMENT_SIZE = 1 << 20;
+    static const int PRIME_WINDOW = 4096;
+    //threads value for "one per hardware thread"
+    static const unsigned ALL_THREADS = ~0u;
+    //threads > 0 selects the parallel format for files over SEGMENT_SIZE
+    Compressor(std::string ifile, std::string ofile, long long len, long long bufsize = 512, bool stream = false,
+               unsigned threads = 0) :bufsize(bufsize), LEN(len), MAX(((long long)1 << len) - 1), stream(stream), threads(threads) {
+        buf = new unsigned char[bufsize];
+        fr = Fileread(ifile, "rb");
+        fw = Filewrite(ofile, "wb");
+        l = 0;
+        r = MAX;
+        half = (r + 1) >> 1;
+        qtr1 = half >> 1;
+        qtr3 = qtr1 * 3;
+    }
+    //coder for one segment of the parallel format, without files
+    Compressor(long long len, long long bufsize) :LEN(len), MAX(((long long)1 << len) - 1), bufsize(bufsize), stream(false), threads(0) {
+        buf = new unsigned char[bufsize];
+        l = 0;
+        r = MAX;
+        half = (r + 1) >> 1;
+        qtr1 = half >> 1;
+        qtr3 = qtr1 * 3;
+    }
+    Compressor() : LEN(0), MAX(0) {}
+    ~Compressor() {
+        delete[] buf;
+    }
+    void compress() {
+        write_header();
+        if (stream) {
+            compress_stream();
+            return;
+        }
+        if (parallel) {
+            compress_parallel();
+            return;
+        }
+        int n;
+        while ((n = read_input(buf, bufsize)) > 0) {
+            encode_block(buf, n, fw);
+        }
+        finish(fw);
+        write_agres(fw);
+    }
+};
+
+class Decompressor {
+private:
+    const int CHARSIZ = 256;
+    const long long LEN, MAX;
+    long long l, r, qtr1, qtr2, qtr3, half, bufsize;
+    int initsize;
+    long long blocks = 0;
+    unsigned char *buf;
+    std::vector<int> agres;
+    Probability prob;
+    Fileread fr;
+    Filewrite fw;
+    int header_size = sizeof(int);
+    //output of an x86-filtered file waits in unfiltered until the E8/E9
+    //filter has seen the bytes after it
+    bool x86 = false;
+    tai::X86BranchFilter filter;
+    std::vector<unsigned char> unfiltered;
+    bool parallel = false;
+    std::vector<unsigned char> piped; //whole-file input from a pipe (Fileread::buffer_rest)
+    void flush_output(bool last) {
+        size_t done = filter.decode(unfiltered.data(), unfiltered.size(), last);
+        fw.write(unfiltered.data(), (int)done);
+        unfiltered.erase(unfiltered.begin(), unfiltered.begin() + done);
+    }
+    void put(unsigned char c) {
+        if (!x86) {
+            fw.write(c);
+            return;
+        }
+        unfiltered.push_back(c);
+        if (unfiltered.size() >= 1 << 16) {
+            flush_output(false);
+        }
+    }
+    void put(const unsigned char data[], size_t n) {
+        if (!x86) {
+            fw.write(data, (int)n);
+            return;
+        }
+        unfiltered.insert(unfiltered.end(), data, data + n);
+        flush_output(false);
+    }
+    void readagr() {
+        long long n_agr = (initsize + bufsize - 1) / bufsize;
+        if (fr.seek(0, SEEK_END) != 0 || fr.seek(-((n_agr * 5 + 7) / 8) * 1, SEEK_CUR) != 0) {
+            std::cerr << "truncated input" << std::endl;
+            exit(1);
+        }
+        for (int i = 0; i < n_agr; i++) {
+            int tmpagr;
+            fr.bread(&tmpagr, 5);
+            agres.push_back(tmpagr);
+        }
+        fr.fflush();
+    }
+public:
+    Decompressor(std::string ifile, std::string ofile, long long len, long long bufsize = 512) : l(l), r(r), bufsize(bufsize), LEN(len), MAX(((long long)1 << len) - 1) {
+        buf = new unsigned char[bufsize];
+        fr = Fileread(ifile, "rb");
+        fw = Filewrite(ofile, "wb");
+        fr.read(&initsize);
+        if (initsize == -2) {
+            x86 = true;
+            header_size += sizeof(int);
+            fr.read(&initsize);
+        }
+        if (initsize == -3) {
+            parallel = true;
+            header_size += sizeof(int);
+            fr.read(&initsize);
+        }
+        l = 0;
+        r = MAX;
+        half = (r + 1) >> 1;
+        qtr1 = half >> 1;
+        qtr3 = qtr1 * 3;
+    }
+    //decoder for one segment of the parallel format, writing to out
+    Decompressor(std::vector<unsigned char> *out, long long len, long long bufsize) : LEN(len), MAX(((long long)1 << len) - 1), bufsize(bufsize), fw(out) {
+        buf = new unsigned char[bufsize];
+        l = 0;
+        r = MAX;
+        half = (r + 1) >> 1;
+        qtr1 = half >> 1;
+        qtr3 = qtr1 * 3;
+    }
+    Decompressor() : LEN(0), MAX(0) {}
+    ~Decompressor() {
+        delete[] buf;
+    }
+    //decodes count symbols from in, taking the block parameters from agres
+    void decode(Fileread &in, int count) {
+        TAI_PHASE(DecodeData);
+        TAI_TRACE_BLOCK(Decode, blocks);
+        long long val = 0, m_agr = 0;
+        l = 0;
+        r = MAX;
+        for (int j = LEN - 1; j >= 0; j--) {
+            int bit_r;
+            if (in.bread(&bit_r)) {
+                val |= ((long long)1 << j) * bit_r;
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            if (i % bufsize == 0) {
+                int st;
+                if (i > 0) {
+                    TAI_PROBE4(block__end, 2, blocks, bufsize, bufsize * 8);
+                    blocks++;
+                }
+                TAI_PROBE3(block__start, 2, blocks, std::min((long long)count - i, bufsize));
+                st = agres[m_agr++];
+                prob.set_add(1 << st);
+            }
+            for (int j = 1; j <= CHARSIZ; j++) {
+                long long ll = l, rr = r;
+                prob.get_borders(ll, rr, j);
+                if (ll <= val && val <= rr) {
+                    unsigned char Cout = j - 1;
+                    prob.inc(j);
+                    put(Cout);
+                    l = ll;
+                    r = rr;
+                    break;
+                }
+            }
+            while (1) {
+                if (r < half) {
+                }
+                else if (l >= half) {
+                    l -= half;
+                    r -= half;
+                    val -= half;
+                }
+                else if (l >= qtr1 && r < qtr3) {
+                    l -= qtr1;
+                    r -= qtr1;
+                    val -= qtr1;
+                }
+                else break;
+                l += l;
+                r += r + 1;
+                val += val;
+                int bit_r;
+                if (in.bread(&bit_r)) {
+                    val |= bit_r;
+                }
+            }
+
+        }
+        if (count > 0) {
+            [[maybe_unused]] long long last = count - (count - 1) / bufsize * bufsize; //probe argument only
+            TAI_PROBE4(block__end, 2, blocks, last, last * 8);
+            blocks++;
+        }
+    }
+    void decompress_stream() {
+        int n, payload_size;
+        std::vector<unsigned char> payload;
+        long long frame = 0;
+        while (fr.read(&n) == 1 && n > 0) {
+            if (fr.read(&payload_size) != 1 || payload_size < 0) {
+                std::cerr << "truncated stream" << std::endl;
+                exit(1);
+            }
+            payload.resize(payload_size);
+            int got;
+            {
+                TAI_TRACE_BLOCK(Read, blocks);
+                TAI_PROBE1(io__wait__start, 0);
+                got = fr.read(payload.data(), payload_size);
+                TAI_PROBE2(io__wait__end, 0, got);
+            }
+            if (got != payload_size) {
+                std::cerr << "truncated stream" << std::endl;
+                exit(1);
+            }
+            decode_chunk(payload, n);
+            TAI_PROBE3(frame__flush, 2, frame, n);
+            frame++;
+        }
+    }
+    //a stream chunk's or parallel segment's payload: agres bits, then coded bits
+    void decode_chunk(const std::vector<unsigned char> &payload, int n) {
+        Fileread chunk(payload.data(), payload.size());
+        long long n_agr = (n + bufsize - 1) / bufsize;
+        agres.clear();
+        for (int i = 0; i < n_agr; i++) {
+            int tmpagr;
+            chunk.bread(&tmpagr, 5);
+            agres.push_back(tmpagr);
+        }
+        chunk.fflush();
+        decode(chunk, n);
+    }
+    void decode_segment(const std::vector<unsigned char> &payload, int n, const Probability &primed) {
+        prob = primed;
+        decode_chunk(payload, n);
+    }
+    //see Compressor::compress_parallel; segments are read in order, then
+    //decoded concurrently and written in order
+    void decompress_parallel() {
+        int segment_size;
+        if (fr.read(&segment_size) != 1 || segment_size < bufsize || segment_size % bufsize != 0) {
+            std::cerr << "corrupt segment header" << std::endl;
+            exit(1);
+        }
+        size_t segments = ((size_t)initsize + segment_size - 1) / segment_size;
+        std::vector<std::vector<unsigned char>> summaries(segments, std::vector<unsigned char>(Probability::SUMMARY_BYTES));
+        std::vector<std::vector<unsigned char>> payloads(segments), outputs(segments);
+        for (size_t i = 0; i < segments; i++) {
+            TAI_TRACE_BLOCK(Read, i * (segment_size / bufsize));
+            int payload_size;
+            TAI_PROBE1(io__wait__start, 0);
+            if (fr.read(summaries[i].data(), Probability::SUMMARY_BYTES) != Probability::SUMMARY_BYTES ||
+                fr.read(&payload_size) != 1 || payload_size < 0) {
+                std::cerr << "truncated segment" << std::endl;
+                exit(1);
+            }
+            payloads[i].resize(payload_size);
+            int got = fr.read(payloads[i].data(), payload_size);
+            TAI_PROBE2(io__wait__end, 0, got);
+            if (got != payload_size) {
+                std::cerr << "truncated segment" << std::endl;
+                exit(1);
+            }
+        }
+        tai::parallelFor(segments, [&](size_t i) {
+            Probability primed;
+            if (i > 0) {
+                primed.prime(summaries[i].data());
+            }
+            Decompressor segment(&outputs[i], LEN, bufsize);
+            segment.blocks = i * (segment_size / bufsize);
+            segment.decode_segment(payloads[i], (int)std::min((size_t)segment_size, (size_t)initsize - i * segment_size), primed);
+        });
+        for (size_t i = 0; i < segments; i++) {
+            TAI_TRACE_BLOCK(Write, i * (segment_size / bufsize));
+            put(outputs[i].data(), outputs[i].size());
+            std::vector<unsigned char>().swap(outputs[i]);
+        }
+    }
+    void decompress() {
+        if (initsize == -1) {
+            decompress_stream();
+        } else if (parallel) {
+            decompress_parallel();
+        } else {
+            //the agres trailer is read first, so a pipe is buffered whole
+            if (!fr.seekable()) {
+                fr.buffer_rest(piped, header_size);
+            }
+            readagr();
+            if (fr.seek(header_size, SEEK_SET) != 0) {
+                std::cerr << "cannot seek input" << std::endl;
+                exit(1);
+            }
+            decode(fr, initsize);
+        }
+        if (x86) {
+            flush_output(true);
+        }
+    }
+
+};
+
+inline void compress_ari(char *ifile, char *ofile, unsigned threads = 0) {
+    //pipes can't be sized or seeked, so they get the chunked stream format
+    bool stream = strcmp(ifile, "-") == 0 || strcmp(ofile, "-") == 0;
+    Compressor c(ifile, ofile, 31, 512, stream, threads);
+    c.compress();
+}
+
+inline void decompress_ari(std::string ifile, std::string ofile) {
+    Decompressor c(ifile, ofile, 31, 512);
+    c.decompress();
+}
+
+#endif
@@ -0,0 +1,302 @@
+#ifndef TAI_CODER_COMPRESSED_STREAMBUF_H
+#define TAI_CODER_COMPRESSED_STREAMBUF_H
+
+// std::streambuf adapters over encoder 1, so existing iostream code can read
+// and write compressed data directly:
+//
+//   std::ofstream file("log.aris", std::ios::binary);
+//   tai::compressing_streambuf zbuf(file);
+//   std::ostream out(&zbuf);
+//   out << ...;
+//   zbuf.finish();                      // or let the destructor do it
+//
+//   std::ifstream file("log.aris", std::ios::binary);
+//   tai::decompressing_streambuf zbuf(file);
+//   std::istream in(&zbuf);
+//   in.seekg(offset);                   // decodes only the frame holding offset
+//
+// Both sides buffer a whole frame (STREAM_BLOCK_SIZE bytes of plain data),
+// and the xsputn/xsgetn overrides move data in bulk, so there is no virtual
+// call per character. The output side writes the streaming ("ARIS") format,
+// by default with the 64-bit coder; the input side reads every encoder 1
+// format. Seeking needs a seekable underlying istream and only reads frame
+// headers until it reaches the target frame.
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+#include "arithmetic_encoder_1.h"
+
+namespace tai {
+
+class compressing_streambuf : public std::streambuf {
+private:
+    std::ostream& out;
+    ArithmeticEncoder engine;
+    ArithmeticEncoder::Coder coder;
+    std::vector<unsigned char> block;
+    uint64_t frame = 0;
+    bool finished = false;
+
+    void resetPut() {
+        char* base = reinterpret_cast<char*>(block.data());
+        setp(base, base + block.size());
+    }
+
+    void writeBlock() {
+        size_t used = static_cast<size_t>(pptr() - pbase());
+        if (used == 0) return;
+        block.resize(used);
+        engine.writeFrame(out, block, coder, frame++);
+        block.resize(ArithmeticEncoder::STREAM_BLOCK_SIZE);
+        resetPut();
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (finished) return traits_type::eof();
+        writeBlock();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        if (finished) return 0;
+        std::streamsize done = 0;
+        while (done < n) {
+            if (pptr() == epptr()) writeBlock();
+            std::streamsize room = epptr() - pptr();
+            std::streamsize chunk = std::min(room, n - done);
+            std::memcpy(pptr(), s + done, static_cast<size_t>(chunk));
+            pbump(static_cast<int>(chunk));
+            done += chunk;
+        }
+        return done;
+    }
+
+    // Flushing the ostream does not cut a frame (a flush per line would
+    // wreck the ratio); it only flushes what earlier frames wrote.
+    int sync() override {
+        out.flush();
+        return out ? 0 : -1;
+    }
+
+public:
+    explicit compressing_streambuf(std::ostream& output,
+                                   ArithmeticEncoder::Coder c = ArithmeticEncoder::Coder::Wide)
+        : out(output), coder(c), block(ArithmeticEncoder::STREAM_BLOCK_SIZE) {
+        engine.writeStreamHeader(out, coder);
+        resetPut();
+    }
+
+    ~compressing_streambuf() override {
+        try {
+            finish();
+        } catch (...) {
+            // Destructors must not throw; call finish() to see errors.
+        }
+    }
+
+    compressing_streambuf(const compressing_streambuf&) = delete;
+    compressing_streambuf& operator=(const compressing_streambuf&) = delete;
+
+    // Writes the buffered data and the end-of-stream marker. Nothing can be
+    // written afterwards.
+    void finish() {
+        if (finished) return;
+        writeBlock();
+        finished = true;
+        setp(nullptr, nullptr);
+        engine.writeStreamEnd(out);
+        out.flush();
+        if (!out) throw std::runtime_error("Write error");
+    }
+};
+
+class decompressing_streambuf : public std::streambuf {
+private:
+    struct FrameEntry {
+        std::streampos offset;      // of the frame header in the compressed stream
+        uint64_t start;             // of the frame's data in the decoded stream
+        uint32_t size;
+    };
+
+    std::istream& in;
+    ArithmeticEncoder engine;
+    ArithmeticEncoder::Coder coder;
+    tai::Transform transform;
+    bool framed;
+    bool at_end = false;
+    std::vector<unsigned char> buffer;
+    uint64_t buffer_start = 0;      // decoded-stream offset of buffer[0]
+    uint64_t next_frame = 0;
+
+    std::streampos first_frame = -1;
+    std::vector<FrameEntry> index;
+    bool indexed = false;
+
+    void setBuffer(size_t position) {
+        char* base = reinterpret_cast<char*>(buffer.data());
+        setg(base, base + position, base + buffer.size());
+    }
+
+    // Replaces the buffer with the next decoded frame; false at the end.
+    bool nextBuffer() {
+        if (at_end) return false;
+        if (!framed) {
+            // Whole-file formats decode in one piece, kept for seeking.
+            if (next_frame > 0) {
+                at_end = true;
+                return false;
+            }
+            engine.readWholeFile(in, coder, buffer, transform);
+        } else {
+            uint64_t start = buffer_start + buffer.size();
+            bool more = engine.readFrame(in, coder, buffer, next_frame);
+            buffer_start = start;
+            if (!more) {
+                at_end = true;
+                setBuffer(0);
+                return false;
+            }
+        }
+        next_frame++;
+        setBuffer(0);
+        return true;
+    }
+
+    // Walks the frame headers once, without decoding, to map decoded
+    // offsets to compressed ones. Needs a seekable input.
+    bool buildIndex() {
+        if (indexed) return true;
+        if (first_frame == std::streampos(-1)) return false;
+        std::streampos resume = in.tellg();
+        in.clear();
+        in.seekg(first_frame);
+        uint64_t start = 0;
+        for (;;) {
+            std::streampos offset = in.tellg();
+            uint32_t size = ArithmeticEncoder::skipFrame(in);
+            if (size == 0) break;
+            index.push_back({offset, start, size});
+            start += size;
+        }
+        in.clear();
+        in.seekg(resume);
+        indexed = true;
+        return true;
+    }
+
+    pos_type seekFramed(uint64_t target) {
+        if (!buildIndex()) return pos_type(off_type(-1));
+        uint64_t total = index.empty() ? 0 : index.back().start + index.back().size;
+        if (target > total) return pos_type(off_type(-1));
+        if (target < buffer_start || target >= buffer_start + buffer.size()) {
+            if (target == total) {
+                // End of stream: leave the reader positioned on the end marker.
+                in.clear();
+                in.seekg(index.empty() ? first_frame : index.back().offset);
+                if (!index.empty()) ArithmeticEncoder::skipFrame(in);
+                buffer.clear();
+                buffer_start = total;
+                next_frame = index.size();
+                at_end = false;
+                setBuffer(0);
+                return pos_type(off_type(target));
+            }
+            auto it = std::upper_bound(index.begin(), index.end(), target,
+                [](uint64_t t, const FrameEntry& e) { return t < e.start; }) - 1;
+            in.clear();
+            in.seekg(it->offset);
+            next_frame = static_cast<uint64_t>(it - index.begin());
+            at_end = false;
+            buffer.clear();
+            buffer_start = it->start;
+            nextBuffer();
+        }
+        setBuffer(static_cast<size_t>(target - buffer_start));
+        return pos_type(off_type(target));
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        while (nextBuffer()) {
+            if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        }
+        return traits_type::eof();
+    }
+
+    std::streamsize xsgetn(char* s, std::streamsize n) override {
+        std::streamsize done = 0;
+        while (done < n) {
+            if (gptr() == egptr() && !nextBuffer()) break;
+            std::streamsize chunk = std::min<std::streamsize>(egptr() - gptr(), n - done);
+            std::memcpy(s + done, gptr(), static_cast<size_t>(chunk));
+            gbump(static_cast<int>(chunk));
+            done += chunk;
+        }
+        return done;
+    }
+
+    std::streamsize showmanyc() override {
+        return egptr() - gptr();
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                     std::ios_base::openmode which = std::ios_base::in) override {
+        if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+        uint64_t current = buffer_start + static_cast<uint64_t>(gptr() - eback());
+        if (dir == std::ios_base::cur && off == 0) return pos_type(off_type(current));
+
+        off_type base = 0;
+        if (dir == std::ios_base::cur) {
+            base = static_cast<off_type>(current);
+        } else if (dir == std::ios_base::end) {
+            if (!framed) {
+                while (nextBuffer()) {}
+                base = static_cast<off_type>(buffer_start + buffer.size());
+            } else {
+                if (!buildIndex()) return pos_type(off_type(-1));
+                base = index.empty() ? 0 : static_cast<off_type>(index.back().start + index.back().size);
+            }
+        }
+        return seekpos(pos_type(base + off), which);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in) override {
+        if (!(which & std::ios_base::in) || off_type(pos) < 0) return pos_type(off_type(-1));
+        uint64_t target = static_cast<uint64_t>(off_type(pos));
+        if (framed) return seekFramed(target);
+
+        if (next_frame == 0) nextBuffer();
+        if (target > buffer.size()) return pos_type(off_type(-1));
+        buffer_start = 0;
+        at_end = false;
+        setBuffer(static_cast<size_t>(target));
+        return pos;
+    }
+
+public:
+    // Reads the format header straight away; throws std::runtime_error if
+    // input does not hold encoder 1 data.
+    explicit decompressing_streambuf(std::istream& input) : in(input) {
+        framed = ArithmeticEncoder::readFormat(in, coder, transform);
+        if (framed) first_frame = in.tellg();
+        setBuffer(0);
+    }
+
+    decompressing_streambuf(const decompressing_streambuf&) = delete;
+    decompressing_streambuf& operator=(const decompressing_streambuf&) = delete;
+};
+
+} // namespace tai
+
+#endif
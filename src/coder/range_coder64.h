@@ -0,0 +1,125 @@
+#ifndef TAI_CODER_RANGE_CODER64_H
+#define TAI_CODER_RANGE_CODER64_H
+
+// Range coder with 64-bit state and 32-bit frequency precision.
+//
+// low/range are 64 bits wide and renormalisation moves a whole 32-bit word
+// at a time, so there is at most one renormalisation per symbol and no
+// per-bit loop. Frequencies may use the full 32 bits (total < 2^32): range
+// never drops below 2^32 between symbols, so range / total >= 1 always.
+// Carries out of low are propagated LZMA-style through a one-word cache
+// plus a count of pending 0xFFFFFFFF words. Words are written big-endian.
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace tai {
+
+class RangeEncoder64 {
+private:
+    static const uint64_t TOP = uint64_t(1) << 32;
+
+    std::vector<unsigned char>& out;
+    uint64_t low = 0;
+    uint64_t range = ~uint64_t(0);
+    uint32_t carry = 0;
+    uint32_t cache = 0;
+    uint64_t cache_size = 0;    // cache plus the pending 0xFFFFFFFF words
+
+    void putWord(uint32_t w) {
+        out.push_back(static_cast<unsigned char>(w >> 24));
+        out.push_back(static_cast<unsigned char>(w >> 16));
+        out.push_back(static_cast<unsigned char>(w >> 8));
+        out.push_back(static_cast<unsigned char>(w));
+    }
+
+    void shiftLow() {
+        uint32_t top = static_cast<uint32_t>(low >> 32);
+        if (top != 0xFFFFFFFFu || carry || cache_size == 0) {
+            if (cache_size > 0) {
+                putWord(cache + carry);
+                for (uint64_t i = 1; i < cache_size; i++) {
+                    putWord(0xFFFFFFFFu + carry);
+                }
+            }
+            cache = top;
+            cache_size = 0;
+        }
+        cache_size++;
+        carry = 0;
+        low <<= 32;
+    }
+
+public:
+    explicit RangeEncoder64(std::vector<unsigned char>& output) : out(output) {}
+
+    // Codes the interval [cum, cum + freq) of total; requires freq > 0 and
+    // cum + freq <= total < 2^32.
+    void encode(uint32_t cum, uint32_t freq, uint32_t total) {
+        uint64_t r = range / total;
+        uint64_t next = low + r * cum;
+        carry |= next < low;
+        low = next;
+        range = r * freq;
+        if (range < TOP) {
+            shiftLow();
+            range <<= 32;
+        }
+    }
+
+    void finish() {
+        for (int i = 0; i < 3; i++) {
+            shiftLow();
+        }
+    }
+};
+
+class RangeDecoder64 {
+private:
+    static const uint64_t TOP = uint64_t(1) << 32;
+
+    const unsigned char* in;
+    const unsigned char* end;
+    uint64_t code = 0;
+    uint64_t range = ~uint64_t(0);
+    uint64_t r = 0;
+
+    uint32_t getWord() {
+        uint32_t w = 0;
+        for (int i = 0; i < 4; i++) {
+            w = (w << 8) | (in < end ? *in++ : 0);
+        }
+        return w;
+    }
+
+public:
+    RangeDecoder64(const unsigned char* data, size_t size) : in(data), end(data + size) {
+        code = (static_cast<uint64_t>(getWord()) << 32) | getWord();
+    }
+
+    // Returns the cumulative frequency the next symbol falls on; must be
+    // followed by consume() with that symbol's interval.
+    uint32_t peek(uint32_t total) {
+        r = range / total;
+        uint64_t v = code / r;
+        if (v >= total) {
+            throw std::runtime_error("Corrupt range coder stream");
+        }
+        return static_cast<uint32_t>(v);
+    }
+
+    void consume(uint32_t cum, uint32_t freq) {
+        code -= r * cum;
+        range = r * freq;
+        if (range < TOP) {
+            code = (code << 32) | getWord();
+            range <<= 32;
+        }
+    }
+};
+
+} // namespace tai
+
+#endif
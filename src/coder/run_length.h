@@ -0,0 +1,135 @@
+#ifndef TAI_CODER_RUN_LENGTH_H
+#define TAI_CODER_RUN_LENGTH_H
+
+// Run mode for the adaptive range coders of encoder 1.
+//
+// Once RUN_TRIGGER equal bytes in a row have been coded, the coder stops
+// coding that byte one at a time: it codes how many more copies follow
+// (possibly none) with this model, and normal coding resumes at the first
+// byte that differs. Neither the byte model nor the context-mixing predictor
+// sees the copies, so a long run costs a few dozen bits and one
+// runLength() scan whatever its length.
+//
+// A count n is coded as the bit length k of n + 1 in unary, then the k - 1
+// bits below its leading one. The unary bits and the first MODELED_BITS of
+// the others have adaptive probabilities; the rest are coded flat.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "../common/byte_scan.h"
+#include "range_coder64.h"
+
+namespace tai {
+
+class RunLengthModel {
+public:
+    static const int RUN_TRIGGER = 8;
+
+private:
+    static const int MAX_BITS = 64;
+    static const int MODELED_BITS = 4;
+    static const int RATE = 4;
+
+    uint16_t longer[MAX_BITS];                  // P(bit length > k + 1)
+    uint16_t high[MAX_BITS][MODELED_BITS];      // P(1) of the bits under the leading one
+    unsigned char last = 0;
+    int repeats = 0;
+
+    static uint32_t p12(uint16_t p) {
+        return std::min<uint32_t>(4095, std::max<uint32_t>(1, p >> 4));
+    }
+
+    static void adapt(uint16_t& p, int bit) {
+        if (bit) {
+            p = static_cast<uint16_t>(p + ((65535 - p) >> RATE));
+        } else {
+            p = static_cast<uint16_t>(p - (p >> RATE));
+        }
+    }
+
+    static void encodeBit(RangeEncoder64& encoder, uint16_t& p, int bit) {
+        uint32_t q = p12(p);
+        if (bit) {
+            encoder.encode(0, q, 4096);
+        } else {
+            encoder.encode(q, 4096 - q, 4096);
+        }
+        adapt(p, bit);
+    }
+
+    static int decodeBit(RangeDecoder64& decoder, uint16_t& p) {
+        uint32_t q = p12(p);
+        int bit = decoder.peek(4096) < q;
+        if (bit) {
+            decoder.consume(0, q);
+        } else {
+            decoder.consume(q, 4096 - q);
+        }
+        adapt(p, bit);
+        return bit;
+    }
+
+public:
+    RunLengthModel() {
+        std::fill(longer, longer + MAX_BITS, uint16_t(32768));
+        std::fill(&high[0][0], &high[0][0] + MAX_BITS * MODELED_BITS, uint16_t(32768));
+    }
+
+    // Feeds a byte coded the normal way; returns true when a run length
+    // must be coded next (encode() or decode()).
+    bool push(unsigned char byte) {
+        if (repeats > 0 && byte == last) {
+            repeats++;
+        } else {
+            last = byte;
+            repeats = 1;
+        }
+        return repeats >= RUN_TRIGGER;
+    }
+
+    // Number of further copies of the run's byte at the start of data.
+    size_t measure(const unsigned char* data, size_t size) const {
+        return runLength(data, size, last);
+    }
+
+    void encode(RangeEncoder64& encoder, uint64_t n) {
+        repeats = 0;
+        uint64_t v = n + 1;     // n < 2^64 - 1: n counts bytes in memory
+        int k = 64 - __builtin_clzll(v);
+        for (int j = 1; j < k; j++) encodeBit(encoder, longer[j - 1], 1);
+        if (k < MAX_BITS) encodeBit(encoder, longer[k - 1], 0);
+        for (int j = k - 2, m = 0; j >= 0; j--, m++) {
+            int bit = static_cast<int>((v >> j) & 1);
+            if (m < MODELED_BITS) {
+                encodeBit(encoder, high[k - 1][m], bit);
+            } else {
+                encoder.encode(static_cast<uint32_t>(bit), 1, 2);
+            }
+        }
+    }
+
+    uint64_t decode(RangeDecoder64& decoder) {
+        repeats = 0;
+        int k = 1;
+        while (k < MAX_BITS && decodeBit(decoder, longer[k - 1])) k++;
+        uint64_t v = 1;
+        for (int j = k - 2, m = 0; j >= 0; j--, m++) {
+            int bit;
+            if (m < MODELED_BITS) {
+                bit = decodeBit(decoder, high[k - 1][m]);
+            } else {
+                bit = decoder.peek(2) != 0;
+                decoder.consume(static_cast<uint32_t>(bit), 1);
+            }
+            v = (v << 1) | static_cast<uint64_t>(bit);
+        }
+        return v - 1;
+    }
+};
+
+} // namespace tai
+
+#endif
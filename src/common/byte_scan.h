@@ -0,0 +1,184 @@
+#ifndef TAI_COMMON_BYTE_SCAN_H
+#define TAI_COMMON_BYTE_SCAN_H
+
+// Scan for the first byte b with (b & mask) == value, e.g. mask 0xFE and
+// value 0xE8 finds x86 CALL/JMP opcodes. Filters that act on rare bytes
+// spend most of their time here, so the vector variants test 16, 32 or 64
+// bytes per step and fall back to the scalar loop for the tail.
+//
+// runLength() is the converse: how many leading bytes equal value. The run
+// mode of the range coders measures runs with it, so a zero-filled region
+// is skipped at memory speed.
+
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace tai {
+
+namespace byte_scan_detail {
+
+inline size_t scalar(const unsigned char* data, size_t size, unsigned char mask, unsigned char value) {
+    for (size_t i = 0; i < size; i++) {
+        if ((data[i] & mask) == value) return i;
+    }
+    return size;
+}
+
+inline size_t runScalar(const unsigned char* data, size_t size, unsigned char value) {
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] != value) return i;
+    }
+    return size;
+}
+
+#if TAI_X86
+TAI_TARGET("sse2")
+inline size_t sse2(const unsigned char* data, size_t size, unsigned char mask, unsigned char value) {
+    const __m128i m = _mm_set1_epi8(static_cast<char>(mask));
+    const __m128i v = _mm_set1_epi8(static_cast<char>(value));
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int hits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(x, m), v));
+        if (hits) return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(hits)));
+    }
+    return i + scalar(data + i, size - i, mask, value);
+}
+
+TAI_TARGET("avx2")
+inline size_t avx2(const unsigned char* data, size_t size, unsigned char mask, unsigned char value) {
+    const __m256i m = _mm256_set1_epi8(static_cast<char>(mask));
+    const __m256i v = _mm256_set1_epi8(static_cast<char>(value));
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        unsigned hits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(x, m), v)));
+        if (hits) return i + static_cast<size_t>(__builtin_ctz(hits));
+    }
+    return i + scalar(data + i, size - i, mask, value);
+}
+
+TAI_TARGET("avx512f,avx512bw,avx512vl")
+inline size_t avx512(const unsigned char* data, size_t size, unsigned char mask, unsigned char value) {
+    const __m512i m = _mm512_set1_epi8(static_cast<char>(mask));
+    const __m512i v = _mm512_set1_epi8(static_cast<char>(value));
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m512i x = _mm512_loadu_si512(data + i);
+        uint64_t hits = _mm512_cmpeq_epi8_mask(_mm512_and_si512(x, m), v);
+        if (hits) return i + static_cast<size_t>(__builtin_ctzll(hits));
+    }
+    return i + scalar(data + i, size - i, mask, value);
+}
+
+TAI_TARGET("sse2")
+inline size_t runSse2(const unsigned char* data, size_t size, unsigned char value) {
+    const __m128i v = _mm_set1_epi8(static_cast<char>(value));
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        unsigned misses = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, v))) & 0xFFFF;
+        if (misses) return i + static_cast<size_t>(__builtin_ctz(misses));
+    }
+    return i + runScalar(data + i, size - i, value);
+}
+
+// Two vectors per step: long runs are the common case here.
+TAI_TARGET("avx2")
+inline size_t runAvx2(const unsigned char* data, size_t size, unsigned char value) {
+    const __m256i v = _mm256_set1_epi8(static_cast<char>(value));
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), v);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32)), v);
+        if (static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(a, b))) != 0xFFFFFFFFu) break;
+    }
+    for (; i + 32 <= size; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        unsigned misses = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, v)));
+        if (misses) return i + static_cast<size_t>(__builtin_ctz(misses));
+    }
+    return i + runScalar(data + i, size - i, value);
+}
+
+TAI_TARGET("avx512f,avx512bw,avx512vl")
+inline size_t runAvx512(const unsigned char* data, size_t size, unsigned char value) {
+    const __m512i v = _mm512_set1_epi8(static_cast<char>(value));
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        uint64_t misses = ~_mm512_cmpeq_epi8_mask(_mm512_loadu_si512(data + i), v);
+        if (misses) return i + static_cast<size_t>(__builtin_ctzll(misses));
+    }
+    return i + runScalar(data + i, size - i, value);
+}
+#endif
+
+} // namespace byte_scan_detail
+
+using ByteScanFn = size_t (*)(const unsigned char*, size_t, unsigned char, unsigned char);
+
+inline const Kernel<ByteScanFn> byteScanKernel("byte_scan", {
+    {Isa::Scalar, byte_scan_detail::scalar},
+#if TAI_X86
+    {Isa::SSE2, byte_scan_detail::sse2},
+    {Isa::AVX2, byte_scan_detail::avx2},
+    {Isa::AVX512, byte_scan_detail::avx512},
+#endif
+});
+
+// Index of the first byte of data[0, size) with (b & mask) == value, or size.
+inline size_t findMasked(const unsigned char* data, size_t size, unsigned char mask, unsigned char value) {
+    return byteScanKernel.get()(data, size, mask, value);
+}
+
+using ByteRunFn = size_t (*)(const unsigned char*, size_t, unsigned char);
+
+inline const Kernel<ByteRunFn> byteRunKernel("byte_run", {
+    {Isa::Scalar, byte_scan_detail::runScalar},
+#if TAI_X86
+    {Isa::SSE2, byte_scan_detail::runSse2},
+    {Isa::AVX2, byte_scan_detail::runAvx2},
+    {Isa::AVX512, byte_scan_detail::runAvx512},
+#endif
+});
+
+// Number of leading bytes of data[0, size) equal to value.
+inline size_t runLength(const unsigned char* data, size_t size, unsigned char value) {
+    return byteRunKernel.get()(data, size, value);
+}
+
+inline const bool byteScanCheckRegistered = registerKernelCheck("byte_scan",
+    [](std::mt19937_64& rng, std::ostream& log) {
+        std::vector<unsigned char> data = randomKernelInput(rng, 4096);
+        size_t offset = data.empty() ? 0 : rng() % data.size();
+        unsigned char mask = static_cast<unsigned char>((rng() & 1) ? 0xFF : rng());
+        // Half the time look for a byte that is present, so hits get tested.
+        unsigned char value = static_cast<unsigned char>(
+            (data.empty() || (rng() & 1) ? rng() : data[rng() % data.size()]) & mask);
+        return checkKernelVariants(byteScanKernel, log, [&](ByteScanFn fn, ByteScanFn ref) {
+            return fn(data.data() + offset, data.size() - offset, mask, value) ==
+                   ref(data.data() + offset, data.size() - offset, mask, value);
+        });
+    });
+
+inline const bool byteRunCheckRegistered = registerKernelCheck("byte_run",
+    [](std::mt19937_64& rng, std::ostream& log) {
+        // A run of random length (often longer than one vector) followed by
+        // random bytes, so both the loop exit and the tail get tested.
+        std::vector<unsigned char> data = randomKernelInput(rng, 4096);
+        unsigned char value = static_cast<unsigned char>(rng());
+        size_t run = data.empty() ? 0 : rng() % (data.size() + 1);
+        std::fill(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(run), value);
+        size_t offset = data.empty() ? 0 : rng() % data.size();
+        return checkKernelVariants(byteRunKernel, log, [&](ByteRunFn fn, ByteRunFn ref) {
+            return fn(data.data() + offset, data.size() - offset, value) ==
+                   ref(data.data() + offset, data.size() - offset, value);
+        });
+    });
+
+} // namespace tai
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef TAI_COMMON_CPU_DISPATCH_H
+#define TAI_COMMON_CPU_DISPATCH_H
+
+// Runtime CPU feature dispatch for SIMD kernels.
+//
+// Every kernel is compiled in all of its variants (scalar, SSE2, SSE4.2,
+// AVX2, AVX-512) into the same binary with per-function target attributes;
+// the best variant the running CPU supports is picked once, at startup,
+// through cpuid. The scalar variant is the reference: every other variant
+// must produce bit-identical results, which runKernelSelfTest() checks on
+// randomised inputs so streams decode identically across the whole fleet.
+//
+// TAI_ISA=scalar|sse2|sse4.2|avx2|avx512 in the environment caps the level
+// that gets selected (useful to reproduce a run from an older machine).
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TAI_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#define TAI_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TAI_X86 0
+#define TAI_TARGET(isa)
+#endif
+
+namespace tai {
+
+enum class Isa : int {
+    Scalar = 0,
+    SSE2,
+    SSE42,
+    AVX2,
+    AVX512,
+};
+
+inline const char* isaName(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar: return "scalar";
+        case Isa::SSE2:   return "sse2";
+        case Isa::SSE42:  return "sse4.2";
+        case Isa::AVX2:   return "avx2";
+        case Isa::AVX512: return "avx512";
+    }
+    return "?";
+}
+
+struct CpuFeatures {
+    bool sse2 = false;
+    bool sse42 = false;
+    bool avx2 = false;
+    bool avx512 = false;    // AVX-512 F + BW + VL with ZMM state enabled by the OS
+
+    static CpuFeatures detect() {
+        CpuFeatures f;
+#if TAI_X86
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            return f;
+        }
+        f.sse2 = (edx >> 26) & 1;
+        f.sse42 = (ecx >> 20) & 1;
+        bool osxsave = (ecx >> 27) & 1;
+        bool avx = (ecx >> 28) & 1;
+        uint64_t xcr0 = 0;
+        if (osxsave) {
+            uint32_t lo, hi;
+            __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+            xcr0 = (static_cast<uint64_t>(hi) << 32) | lo;
+        }
+        bool ymm_state = (xcr0 & 0x06) == 0x06;
+        bool zmm_state = (xcr0 & 0xE6) == 0xE6;
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            f.avx2 = avx && ymm_state && ((ebx >> 5) & 1);
+            bool avx512f = (ebx >> 16) & 1;
+            bool avx512bw = (ebx >> 30) & 1;
+            bool avx512vl = (ebx >> 31) & 1;
+            f.avx512 = f.avx2 && zmm_state && avx512f && avx512bw && avx512vl;
+        }
+#endif
+        return f;
+    }
+
+    bool supports(Isa isa) const {
+        switch (isa) {
+            case Isa::Scalar: return true;
+            case Isa::SSE2:   return sse2;
+            case Isa::SSE42:  return sse42;
+            case Isa::AVX2:   return avx2;
+            case Isa::AVX512: return avx512;
+        }
+        return false;
+    }
+
+    Isa best() const {
+        if (avx512) return Isa::AVX512;
+        if (avx2) return Isa::AVX2;
+        if (sse42) return Isa::SSE42;
+        if (sse2) return Isa::SSE2;
+        return Isa::Scalar;
+    }
+};
+
+inline const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features = CpuFeatures::detect();
+    return features;
+}
+
+// Highest level kernels may use: what the CPU supports, capped by TAI_ISA.
+inline Isa activeIsa() {
+    static const Isa active = [] {
+        Isa level = cpuFeatures().best();
+        const char* cap = std::getenv("TAI_ISA");
+        if (cap != nullptr) {
+            for (Isa isa : {Isa::Scalar, Isa::SSE2, Isa::SSE42, Isa::AVX2, Isa::AVX512}) {
+                if (std::strcmp(cap, isaName(isa)) == 0 && isa < level) {
+                    level = isa;
+                }
+            }
+        }
+        return level;
+    }();
+    return active;
+}
+
+inline bool isaUsable(Isa isa) {
+    return isa <= activeIsa() && cpuFeatures().supports(isa);
+}
+
+template <typename Fn>
+struct KernelVariant {
+    Isa isa;
+    Fn fn;
+};
+
+// A kernel is a named set of variants of one function; the first variant must
+// be the scalar reference. The selected variant is resolved on construction,
+// so kernels defined as inline globals are bound before main() runs.
+template <typename Fn>
+class Kernel {
+private:
+    const char* kernel_name;
+    std::vector<KernelVariant<Fn>> all;
+    KernelVariant<Fn> chosen;
+
+public:
+    Kernel(const char* name, std::initializer_list<KernelVariant<Fn>> variants)
+        : kernel_name(name), all(variants), chosen(*variants.begin()) {
+        for (const auto& v : all) {
+            if (isaUsable(v.isa) && v.isa >= chosen.isa) {
+                chosen = v;
+            }
+        }
+    }
+
+    Fn get() const { return chosen.fn; }
+    Isa selected() const { return chosen.isa; }
+    Fn reference() const { return all.front().fn; }
+    const char* name() const { return kernel_name; }
+    const std::vector<KernelVariant<Fn>>& variants() const { return all; }
+};
+
+// Self-test registry: each kernel header registers one check that compares
+// every supported variant against the scalar reference.
+struct KernelCheck {
+    const char* name;
+    std::function<bool(std::mt19937_64& rng, std::ostream& log)> run;
+};
+
+inline std::vector<KernelCheck>& kernelChecks() {
+    static std::vector<KernelCheck> checks;
+    return checks;
+}
+
+inline bool registerKernelCheck(const char* name,
+                                std::function<bool(std::mt19937_64&, std::ostream&)> run) {
+    kernelChecks().push_back({name, std::move(run)});
+    return true;
+}
+
+// Runs same(variant, reference) for every variant of kernel the CPU can
+// execute and logs which of them disagree with the scalar result.
+template <typename Fn, typename Compare>
+bool checkKernelVariants(const Kernel<Fn>& kernel, std::ostream& log, Compare same) {
+    bool ok = true;
+    for (const auto& v : kernel.variants()) {
+        if (v.isa == Isa::Scalar) continue;
+        if (!cpuFeatures().supports(v.isa)) {
+            log << "  " << kernel.name() << "/" << isaName(v.isa) << ": skipped (unsupported)\n";
+            continue;
+        }
+        bool match = same(v.fn, kernel.reference());
+        log << "  " << kernel.name() << "/" << isaName(v.isa) << ": "
+            << (match ? "ok" : "MISMATCH") << "\n";
+        ok = ok && match;
+    }
+    return ok;
+}
+
+// Random buffer with a skewed byte distribution (long runs and repeated
+// values as well as noise), so kernels see both easy and adversarial data.
+inline std::vector<unsigned char> randomKernelInput(std::mt19937_64& rng, size_t max_len) {
+    std::vector<unsigned char> data(rng() % (max_len + 1));
+    size_t i = 0;
+    while (i < data.size()) {
+        size_t run = 1 + rng() % ((rng() & 3) == 0 ? 300 : 4);
+        unsigned char value = static_cast<unsigned char>(rng() & ((rng() & 1) ? 0xFF : 0x03));
+        for (size_t k = 0; k < run && i < data.size(); k++, i++) {
+            data[i] = value;
+        }
+    }
+    return data;
+}
+
+inline bool runKernelSelfTest(std::ostream& log, int rounds = 200, uint64_t seed = 0x7A1C0DE5ull) {
+    const CpuFeatures& f = cpuFeatures();
+    log << "CPU features: sse2=" << f.sse2 << " sse4.2=" << f.sse42
+        << " avx2=" << f.avx2 << " avx512=" << f.avx512
+        << " (active: " << isaName(activeIsa()) << ")\n";
+    bool ok = true;
+    for (const auto& check : kernelChecks()) {
+        std::mt19937_64 rng(seed);
+        bool passed = true;
+        for (int r = 0; r < rounds && passed; r++) {
+            std::mt19937_64 round_rng = rng;
+            std::ostream null_log(nullptr);
+            passed = check.run(rng, r + 1 == rounds ? log : null_log);
+            if (!passed) {
+                // Replay the failing round verbosely so the variant is named.
+                check.run(round_rng, log);
+            }
+        }
+        log << check.name << ": " << (passed ? "PASS" : "FAIL") << "\n";
+        ok = ok && passed;
+    }
+    return ok;
+}
+
+} // namespace tai
+
+#endif
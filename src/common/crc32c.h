@@ -0,0 +1,89 @@
+#ifndef TAI_COMMON_CRC32C_H
+#define TAI_COMMON_CRC32C_H
+
+// CRC-32C (Castagnoli) checksum for frame and stream integrity checks.
+// The SSE4.2 variant uses the crc32 instruction; the table-driven scalar
+// variant is the reference it is checked against.
+
+#include "cpu_dispatch.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace tai {
+
+namespace crc32c_detail {
+
+constexpr uint32_t POLY = 0x82F63B78u;
+
+constexpr std::array<uint32_t, 256> makeTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ POLY : c >> 1;
+        }
+        table[i] = c;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint32_t, 256> TABLE = makeTable();
+
+inline uint32_t scalar(uint32_t crc, const unsigned char* data, size_t len) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#if TAI_X86 && defined(__x86_64__)
+TAI_TARGET("sse4.2")
+inline uint32_t sse42(uint32_t crc, const unsigned char* data, size_t len) {
+    uint64_t c = ~crc & 0xFFFFFFFFu;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        c = _mm_crc32_u64(c, word);
+    }
+    uint32_t c32 = static_cast<uint32_t>(c);
+    for (; i < len; i++) {
+        c32 = _mm_crc32_u8(c32, data[i]);
+    }
+    return ~c32;
+}
+#endif
+
+} // namespace crc32c_detail
+
+using Crc32cFn = uint32_t (*)(uint32_t, const unsigned char*, size_t);
+
+inline const Kernel<Crc32cFn> crc32cKernel("crc32c", {
+    {Isa::Scalar, crc32c_detail::scalar},
+#if TAI_X86 && defined(__x86_64__)
+    {Isa::SSE42, crc32c_detail::sse42},
+#endif
+});
+
+// Continues a running checksum: crc32c(crc32c(0, a), b) == crc32c(0, a + b).
+inline uint32_t crc32c(uint32_t crc, const unsigned char* data, size_t len) {
+    return crc32cKernel.get()(crc, data, len);
+}
+
+inline const bool crc32cCheckRegistered = registerKernelCheck("crc32c",
+    [](std::mt19937_64& rng, std::ostream& log) {
+        std::vector<unsigned char> data = randomKernelInput(rng, 4096);
+        size_t offset = data.empty() ? 0 : rng() % data.size();
+        uint32_t seed = static_cast<uint32_t>(rng());
+        return checkKernelVariants(crc32cKernel, log, [&](Crc32cFn fn, Crc32cFn ref) {
+            return fn(seed, data.data() + offset, data.size() - offset) ==
+                   ref(seed, data.data() + offset, data.size() - offset);
+        });
+    });
+
+} // namespace tai
+
+#endif
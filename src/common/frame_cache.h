@@ -0,0 +1,180 @@
+#ifndef TAI_COMMON_FRAME_CACHE_H
+#define TAI_COMMON_FRAME_CACHE_H
+
+// LRU cache of decoded frames, bounded by total bytes and shared between
+// threads.
+//
+// Keys are spread over independently locked shards, so readers of different
+// frames rarely contend; each shard keeps its own LRU order and the byte cap
+// is global. Every use stamps the entry with a tick from a shared counter, so
+// an insert that goes over the cap evicts the shard tail with the oldest tick,
+// the least recently used frame overall, and never the frame it inserted.
+// Frames are handed out as shared_ptrs, so an evicted
+// frame stays valid for readers still copying from it. Two threads missing
+// on the same key both decode it; the first insert wins.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tai {
+
+struct FrameCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t resident_bytes = 0;
+    uint64_t resident_frames = 0;
+
+    double hitRate() const {
+        uint64_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / lookups : 0.0;
+    }
+};
+
+class FrameCache {
+public:
+    using Frame = std::shared_ptr<const std::vector<unsigned char>>;
+
+private:
+    struct Entry {
+        uint64_t key;
+        Frame frame;
+        uint64_t tick;              // last use
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;       // most recently used first
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> map;
+    };
+
+    size_t capacity;
+    std::vector<Shard> shards;
+    std::atomic<uint64_t> used{0};
+    std::atomic<uint64_t> clock{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> evictions{0};
+
+    size_t shardOf(uint64_t key) const {
+        return static_cast<size_t>(key % shards.size());
+    }
+
+    Frame lookup(uint64_t key) {
+        Shard& shard = shards[shardOf(key)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end()) return nullptr;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        it->second->tick = ++clock;
+        return it->second->frame;
+    }
+
+    Frame insert(uint64_t key, Frame frame) {
+        if (frame->size() > capacity) return frame;
+        {
+            Shard& shard = shards[shardOf(key)];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.map.find(key);
+            if (it != shard.map.end()) return it->second->frame;
+            shard.lru.push_front({key, frame, ++clock});
+            shard.map[key] = shard.lru.begin();
+            used += frame->size();
+        }
+        evictDownTo(key);
+        return frame;
+    }
+
+    // Least recently used entry of shard other than keep, or end().
+    static std::list<Entry>::iterator oldest(Shard& shard, uint64_t keep) {
+        if (shard.lru.empty()) return shard.lru.end();
+        auto it = std::prev(shard.lru.end());
+        if (it->key != keep) return it;
+        return it == shard.lru.begin() ? shard.lru.end() : std::prev(it);
+    }
+
+    // Evicts the globally least recently used entries, sparing keep, until
+    // the cap holds. Ticks are taken under the shard lock, so each shard's
+    // list is in tick order and only the tails need comparing.
+    void evictDownTo(uint64_t keep) {
+        while (used.load() > capacity) {
+            Shard* victim_shard = nullptr;
+            uint64_t victim_tick = 0;
+            for (Shard& shard : shards) {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                auto it = oldest(shard, keep);
+                if (it != shard.lru.end() && (!victim_shard || it->tick < victim_tick)) {
+                    victim_shard = &shard;
+                    victim_tick = it->tick;
+                }
+            }
+            if (!victim_shard) return;
+
+            // The tail may have moved since the scan; its new one is still
+            // among the oldest, so evict it rather than scanning again.
+            std::lock_guard<std::mutex> lock(victim_shard->mutex);
+            auto it = oldest(*victim_shard, keep);
+            if (it == victim_shard->lru.end()) continue;
+            used -= it->frame->size();
+            victim_shard->map.erase(it->key);
+            victim_shard->lru.erase(it);
+            evictions++;
+        }
+    }
+
+public:
+    // capacity_bytes caps the decoded bytes held; a frame larger than the
+    // whole cap is returned but not kept.
+    explicit FrameCache(size_t capacity_bytes, size_t shard_count = 16)
+        : capacity(capacity_bytes), shards(shard_count ? shard_count : 1) {}
+
+    FrameCache(const FrameCache&) = delete;
+    FrameCache& operator=(const FrameCache&) = delete;
+
+    // Returns the cached frame for key, or calls load() (which returns a
+    // std::vector<unsigned char>) outside any lock and caches the result.
+    template <typename Load>
+    Frame get(uint64_t key, Load&& load) {
+        if (Frame frame = lookup(key)) {
+            hits++;
+            return frame;
+        }
+        misses++;
+        Frame frame = std::make_shared<const std::vector<unsigned char>>(load());
+        return insert(key, std::move(frame));
+    }
+
+    void clear() {
+        for (Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const Entry& e : shard.lru) used -= e.frame->size();
+            shard.lru.clear();
+            shard.map.clear();
+        }
+    }
+
+    FrameCacheStats stats() {
+        FrameCacheStats s;
+        s.hits = hits.load();
+        s.misses = misses.load();
+        s.evictions = evictions.load();
+        s.resident_bytes = used.load();
+        for (Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            s.resident_frames += shard.map.size();
+        }
+        return s;
+    }
+};
+
+} // namespace tai
+
+#endif
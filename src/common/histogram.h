@@ -0,0 +1,197 @@
+#ifndef TAI_COMMON_HISTOGRAM_H
+#define TAI_COMMON_HISTOGRAM_H
+
+// Byte histogram ("block statistics") engine.
+//
+// Counting into a single table stalls on store-to-load forwarding whenever
+// neighbouring bytes are equal (the increment of count[b] has to wait for the
+// previous one). We count into four tables interleaved by position instead,
+// merge them with a SIMD kernel, and split large inputs across threads.
+
+#include "cpu_dispatch.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace tai {
+
+namespace histogram_detail {
+
+constexpr int LANES = 4;
+// Keeps every uint32 lane (and the merged uint32 sum) from overflowing.
+constexpr size_t MAX_PASS = size_t(1) << 30;
+// Below this many bytes per thread, spawning is not worth it.
+constexpr size_t MIN_BYTES_PER_THREAD = size_t(4) << 20;
+
+using Lanes = uint32_t[LANES][256];
+
+// out[i] += lanes[0][i] + lanes[1][i] + lanes[2][i] + lanes[3][i]
+using MergeFn = void (*)(const uint32_t (*lanes)[256], uint64_t* out);
+
+inline void mergeScalar(const uint32_t (*lanes)[256], uint64_t* out) {
+    for (int i = 0; i < 256; i++) {
+        out[i] += static_cast<uint64_t>(lanes[0][i]) + lanes[1][i] + lanes[2][i] + lanes[3][i];
+    }
+}
+
+#if TAI_X86
+TAI_TARGET("sse2")
+inline void mergeSse2(const uint32_t (*lanes)[256], uint64_t* out) {
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < 256; i += 4) {
+        __m128i s = _mm_add_epi32(
+            _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&lanes[0][i])),
+                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(&lanes[1][i]))),
+            _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&lanes[2][i])),
+                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(&lanes[3][i]))));
+        __m128i* o = reinterpret_cast<__m128i*>(out + i);
+        _mm_storeu_si128(o, _mm_add_epi64(_mm_loadu_si128(o), _mm_unpacklo_epi32(s, zero)));
+        _mm_storeu_si128(o + 1, _mm_add_epi64(_mm_loadu_si128(o + 1), _mm_unpackhi_epi32(s, zero)));
+    }
+}
+
+TAI_TARGET("avx2")
+inline void mergeAvx2(const uint32_t (*lanes)[256], uint64_t* out) {
+    for (int i = 0; i < 256; i += 4) {
+        __m128i s = _mm_add_epi32(
+            _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&lanes[0][i])),
+                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(&lanes[1][i]))),
+            _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&lanes[2][i])),
+                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(&lanes[3][i]))));
+        __m256i* o = reinterpret_cast<__m256i*>(out + i);
+        _mm256_storeu_si256(o, _mm256_add_epi64(_mm256_loadu_si256(o), _mm256_cvtepu32_epi64(s)));
+    }
+}
+
+TAI_TARGET("avx512f,avx512bw,avx512vl")
+inline void mergeAvx512(const uint32_t (*lanes)[256], uint64_t* out) {
+    for (int i = 0; i < 256; i += 8) {
+        __m256i s = _mm256_add_epi32(
+            _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&lanes[0][i])),
+                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&lanes[1][i]))),
+            _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&lanes[2][i])),
+                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&lanes[3][i]))));
+        uint64_t* o = out + i;
+        _mm512_storeu_si512(o, _mm512_add_epi64(_mm512_loadu_si512(o), _mm512_maskz_cvtepu32_epi64(0xFF, s)));
+    }
+}
+#endif
+
+} // namespace histogram_detail
+
+inline const Kernel<histogram_detail::MergeFn> histogramMergeKernel("histogram_merge", {
+    {Isa::Scalar, histogram_detail::mergeScalar},
+#if TAI_X86
+    {Isa::SSE2, histogram_detail::mergeSse2},
+    {Isa::AVX2, histogram_detail::mergeAvx2},
+    {Isa::AVX512, histogram_detail::mergeAvx512},
+#endif
+});
+
+struct ByteHistogram {
+    std::array<uint64_t, 256> counts{};
+    uint64_t total = 0;
+
+    // Adds the bytes of data on the calling thread.
+    void add(const unsigned char* data, size_t len) {
+        histogram_detail::MergeFn merge = histogramMergeKernel.get();
+        alignas(64) histogram_detail::Lanes lanes;
+        while (len > 0) {
+            size_t pass = std::min(len, histogram_detail::MAX_PASS);
+            std::memset(lanes, 0, sizeof(lanes));
+            size_t i = 0;
+            for (; i + 16 <= pass; i += 16) {
+                uint64_t a, b;
+                std::memcpy(&a, data + i, 8);
+                std::memcpy(&b, data + i + 8, 8);
+                for (int k = 0; k < 64; k += 16) {
+                    lanes[0][(a >> k) & 0xFF]++;
+                    lanes[1][(a >> (k + 8)) & 0xFF]++;
+                    lanes[2][(b >> k) & 0xFF]++;
+                    lanes[3][(b >> (k + 8)) & 0xFF]++;
+                }
+            }
+            for (; i < pass; i++) {
+                lanes[i & 3][data[i]]++;
+            }
+            merge(lanes, counts.data());
+            total += pass;
+            data += pass;
+            len -= pass;
+        }
+    }
+
+    void merge(const ByteHistogram& other) {
+        for (int i = 0; i < 256; i++) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+    }
+
+    int distinct() const {
+        return static_cast<int>(std::count_if(counts.begin(), counts.end(),
+                                              [](uint64_t c) { return c != 0; }));
+    }
+
+    // Histogram of data, split across up to max_threads threads (0 = one per
+    // hardware thread) when the input is large enough to pay for them.
+    static ByteHistogram of(const unsigned char* data, size_t len, unsigned max_threads = 0) {
+        unsigned threads = max_threads ? max_threads : std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::min<size_t>(threads,
+                      std::max<size_t>(1, len / histogram_detail::MIN_BYTES_PER_THREAD)));
+        ByteHistogram result;
+        if (threads <= 1) {
+            result.add(data, len);
+            return result;
+        }
+        std::vector<ByteHistogram> parts(threads);
+        std::vector<std::thread> workers;
+        size_t slice = (len + threads - 1) / threads;
+        for (unsigned t = 0; t < threads; t++) {
+            size_t begin = std::min(len, t * slice);
+            size_t end = std::min(len, begin + slice);
+            workers.emplace_back([&parts, t, data, begin, end] {
+                parts[t].add(data + begin, end - begin);
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        for (const auto& p : parts) {
+            result.merge(p);
+        }
+        return result;
+    }
+};
+
+inline const bool histogramCheckRegistered = registerKernelCheck("histogram_merge",
+    [](std::mt19937_64& rng, std::ostream& log) {
+        alignas(64) histogram_detail::Lanes lanes;
+        for (auto& lane : lanes) {
+            for (auto& c : lane) {
+                // Mostly small counts, sometimes large ones; like in add(), the
+                // four lanes never sum past 2^30.
+                c = static_cast<uint32_t>((rng() & 7) == 0 ? (rng() >> 36) : rng() % 1000);
+            }
+        }
+        std::array<uint64_t, 256> base;
+        for (auto& c : base) {
+            c = rng() >> (rng() & 63);
+        }
+        return checkKernelVariants(histogramMergeKernel, log,
+            [&](histogram_detail::MergeFn fn, histogram_detail::MergeFn ref) {
+                std::array<uint64_t, 256> got = base, want = base;
+                fn(lanes, got.data());
+                ref(lanes, want.data());
+                return got == want;
+            });
+    });
+
+} // namespace tai
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef TAI_COMMON_KERNELS_H
+#define TAI_COMMON_KERNELS_H
+
+// Every runtime-dispatched kernel, so that runKernelSelfTest() covers all of
+// them whichever coder it is run from. New kernel headers go here.
+
+#include "byte_scan.h"
+#include "cpu_dispatch.h"
+#include "crc32c.h"
+#include "histogram.h"
+
+#endif
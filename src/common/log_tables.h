@@ -0,0 +1,121 @@
+#ifndef TAI_COMMON_LOG_TABLES_H
+#define TAI_COMMON_LOG_TABLES_H
+
+// Integer log2 / logistic functions backed by tables generated at compile
+// time. They replace floating-point log()/exp() on hot paths (rate search
+// cost estimates, logistic mixing, adaptive probability maps) and give the
+// same result on every machine and compiler, which matters for anything
+// that feeds the coder: encoder and decoder must agree to the bit.
+//
+//   squash(d)   : stretch domain [-2047, 2047] -> 12-bit probability [0, 4095]
+//   stretch(p)  : inverse of squash, p in [0, 4095]
+//   log2Fixed(x): log2(x) in 16.16 fixed point, x >= 1
+
+#include <array>
+#include <cstdint>
+
+namespace tai {
+
+namespace log_tables_detail {
+
+// ln(m) for m in [1, 2) via 2 * atanh((m - 1) / (m + 1)); converges fast
+// because the argument never exceeds 1/3.
+constexpr double lnMantissa(double m) {
+    double y = (m - 1.0) / (m + 1.0);
+    double y2 = y * y;
+    double term = y;
+    double sum = 0.0;
+    for (int k = 1; k < 60; k += 2) {
+        sum += term / k;
+        term *= y2;
+    }
+    return 2.0 * sum;
+}
+
+constexpr int LOG2_FRAC_BITS = 12;
+
+constexpr std::array<uint32_t, (1 << LOG2_FRAC_BITS) + 1> makeLog2Table() {
+    std::array<uint32_t, (1 << LOG2_FRAC_BITS) + 1> table{};
+    const double ln2 = lnMantissa(1.5) + lnMantissa(4.0 / 3.0);    // ln(1.5 * 4/3)
+    for (int i = 0; i <= (1 << LOG2_FRAC_BITS); i++) {
+        double m = 1.0 + static_cast<double>(i) / (1 << LOG2_FRAC_BITS);
+        double v = (i == (1 << LOG2_FRAC_BITS)) ? 1.0 : lnMantissa(m) / ln2;
+        table[i] = static_cast<uint32_t>(v * 65536.0 + 0.5);
+    }
+    return table;
+}
+
+// 33 points of 4096 / (1 + e^-x) for x = -8, -7.5, ..., 8 (PAQ's squash knots).
+inline constexpr std::array<int, 33> SQUASH_KNOTS = {
+    1, 2, 3, 6, 10, 16, 27, 45, 73, 120, 194, 310, 488, 747, 1101,
+    1546, 2047, 2549, 2994, 3348, 3607, 3785, 3901, 3975, 4024,
+    4050, 4068, 4079, 4085, 4089, 4092, 4093, 4094
+};
+
+constexpr int squashInterpolated(int d) {
+    if (d > 2047) return 4095;
+    if (d < -2047) return 1;
+    int w = d & 127;
+    int k = (d >> 7) + 16;
+    return (SQUASH_KNOTS[k] * (128 - w) + SQUASH_KNOTS[k + 1] * w + 64) >> 7;
+}
+
+constexpr std::array<int16_t, 4096> makeStretchTable() {
+    std::array<int16_t, 4096> table{};
+    int pi = 0;
+    for (int x = -2047; x <= 2047; x++) {
+        int v = squashInterpolated(x);
+        for (int j = pi; j <= v; j++) {
+            table[j] = static_cast<int16_t>(x);
+        }
+        pi = v + 1;
+    }
+    for (int j = pi; j < 4096; j++) {
+        table[j] = 2047;
+    }
+    return table;
+}
+
+inline constexpr auto LOG2_TABLE = makeLog2Table();
+inline constexpr auto STRETCH_TABLE = makeStretchTable();
+
+} // namespace log_tables_detail
+
+constexpr int squash(int d) {
+    return log_tables_detail::squashInterpolated(d);
+}
+
+constexpr int stretch(int p) {
+    return log_tables_detail::STRETCH_TABLE[p];
+}
+
+// log2(x) * 65536, exact for powers of two and within 2/65536 otherwise
+// (linear interpolation between 4096 mantissa points).
+constexpr uint32_t log2Fixed(uint64_t x) {
+    if (x == 0) return 0;
+    int msb = 63;
+    while (!((x >> msb) & 1)) msb--;
+    // 28 mantissa bits below the leading one: 12 index the table, 16 interpolate.
+    uint64_t mant = msb >= 28 ? (x >> (msb - 28)) : (x << (28 - msb));
+    uint32_t idx = static_cast<uint32_t>(mant >> 16) & 0xFFF;
+    uint32_t frac = static_cast<uint32_t>(mant) & 0xFFFF;
+    uint32_t lo = log_tables_detail::LOG2_TABLE[idx];
+    uint32_t hi = log_tables_detail::LOG2_TABLE[idx + 1];
+    return (static_cast<uint32_t>(msb) << 16) +
+           lo + static_cast<uint32_t>((static_cast<uint64_t>(hi - lo) * frac) >> 16);
+}
+
+// Cost in 1/65536 bits of coding a symbol of frequency count out of total.
+constexpr uint64_t symbolCostFixed(uint64_t count, uint64_t total) {
+    return count == 0 ? 0 : log2Fixed(total) - log2Fixed(count);
+}
+
+static_assert(squash(0) == 2047, "squash midpoint");
+static_assert(squash(2047) == 4094 && squash(-2047) == 1, "squash range");
+static_assert(stretch(squash(500)) == 500, "stretch inverts squash");
+static_assert(log2Fixed(1) == 0 && log2Fixed(1024) == (10u << 16), "log2 of powers of two");
+static_assert(log2Fixed(3) == 103872, "log2(3) in 16.16");    // 1.5849625 * 65536
+
+} // namespace tai
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef TAI_COMMON_PARALLEL_H
+#define TAI_COMMON_PARALLEL_H
+
+// Minimal fork-join helper for independent work items (columns, segments).
+//
+// parallelFor(n, fn) calls fn(i) for every i in [0, n) on up to one thread
+// per hardware thread; workers pull the next index from a shared counter, so
+// uneven items balance themselves. The first exception thrown by fn is
+// rethrown on the calling thread once every worker has stopped.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tai {
+
+template <typename Fn>
+void parallelFor(size_t n, Fn&& fn, unsigned max_threads = 0) {
+    unsigned threads = max_threads ? max_threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, n));
+    if (threads <= 1) {
+        for (size_t i = 0; i < n; i++) fn(i);
+        return;
+    }
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto work = [&] {
+        for (size_t i; (i = next++) < n;) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = std::current_exception();
+                next = n;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++) workers.emplace_back(work);
+    work();
+    for (auto& w : workers) w.join();
+    if (error) std::rethrow_exception(error);
+}
+
+} // namespace tai
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef TAI_COMMON_PHASE_H
+#define TAI_COMMON_PHASE_H
+
+// Coder phases for in-process profilers.
+//
+// TAI_PHASE(Name) marks the rest of the enclosing scope as phase Name. Until
+// a profiler installs a PhaseHook (the benchmark's -p does, to attribute
+// hardware counters) a scope costs one relaxed load and a branch, so the
+// markers can sit on hot paths such as Probability::inc. Phases nest and
+// are inclusive: FindBest contains the ProbabilityInc calls of its trial
+// runs. With -DTAI_NO_PHASES the markers compile away.
+//
+//   BuildFrequencyTable   encoder 1 order-0 count and symbol table
+//   EncodeData            the coding loop (encoder 2: after findbest)
+//   DecodeData            the decoding loop
+//   FindBest              encoder 2's per-block rate search
+//   ProbabilityInc        encoder 2's model update
+
+#include <atomic>
+
+namespace tai {
+
+enum class Phase : int {
+    BuildFrequencyTable,
+    EncodeData,
+    DecodeData,
+    FindBest,
+    ProbabilityInc,
+    COUNT
+};
+
+inline const char* phaseName(Phase phase) {
+    static const char* const names[] = {
+        "buildFrequencyTable", "encodeData", "decodeData", "findbest", "Probability::inc"
+    };
+    return names[static_cast<int>(phase)];
+}
+
+// Called on entry to and exit from every marked scope, from whichever
+// thread runs it.
+class PhaseHook {
+public:
+    virtual ~PhaseHook() = default;
+    virtual void enter(Phase phase) = 0;
+    virtual void exit(Phase phase) = 0;
+};
+
+inline std::atomic<PhaseHook*>& phaseHook() {
+    static std::atomic<PhaseHook*> hook{nullptr};
+    return hook;
+}
+
+class PhaseScope {
+private:
+    PhaseHook* hook;
+    Phase phase;
+
+public:
+    explicit PhaseScope(Phase p) : hook(phaseHook().load(std::memory_order_relaxed)), phase(p) {
+        if (hook) hook->enter(phase);
+    }
+    ~PhaseScope() {
+        if (hook) hook->exit(phase);
+    }
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+};
+
+} // namespace tai
+
+#ifdef TAI_NO_PHASES
+#define TAI_PHASE(name) do {} while (0)
+#else
+#define TAI_PHASE(name) ::tai::PhaseScope tai_phase_scope_(::tai::Phase::name)
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef TAI_COMMON_PROBES_H
+#define TAI_COMMON_PROBES_H
+
+// USDT static tracepoints, provider "tai".
+//
+// With <sys/sdt.h> (systemtap-sdt-dev) every probe compiles to a single nop
+// plus an ELF note: free until bpftrace/perf attaches to it, so production
+// binaries keep them. Without the header (or with -DTAI_NO_USDT) they
+// compile away entirely.
+//
+//   block__start(coder, block, bytes_in)
+//   block__end(coder, block, bytes_in, bits_out)
+//   findbest__start(block, bytes_in)
+//   findbest__end(block, best_shift)
+//   model__rescale(total)
+//   frame__flush(coder, frame, bytes)
+//   io__wait__start(op)                 op: 0 = read, 1 = write
+//   io__wait__end(op, bytes)
+//
+// coder is 1 or 2 (arithmetic_encoder_1/2). List the probes of a binary with
+// `readelf -n ./arithmetic_encoder_2 | grep -A2 stapsdt`; for example
+//   bpftrace -e 'usdt:./arithmetic_encoder_2:tai:findbest__start { @t[tid] = nsecs; }
+//                usdt:./arithmetic_encoder_2:tai:findbest__end { @ns = hist(nsecs - @t[tid]); }'
+
+#if !defined(TAI_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define TAI_HAVE_USDT 1
+#endif
+#endif
+
+#ifdef TAI_HAVE_USDT
+#define TAI_PROBE1(name, a) DTRACE_PROBE1(tai, name, a)
+#define TAI_PROBE2(name, a, b) DTRACE_PROBE2(tai, name, a, b)
+#define TAI_PROBE3(name, a, b, c) DTRACE_PROBE3(tai, name, a, b, c)
+#define TAI_PROBE4(name, a, b, c, d) DTRACE_PROBE4(tai, name, a, b, c, d)
+#else
+#define TAI_PROBE1(name, a) do {} while (0)
+#define TAI_PROBE2(name, a, b) do {} while (0)
+#define TAI_PROBE3(name, a, b, c) do {} while (0)
+#define TAI_PROBE4(name, a, b, c, d) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef TAI_COMMON_STATISTICS_H
+#define TAI_COMMON_STATISTICS_H
+
+struct Statistics {
+    long long original_size;
+    long long compressed_size;
+    double compression_ratio;
+    long long space_saved;
+};
+
+#endif
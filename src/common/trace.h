@@ -0,0 +1,185 @@
+#ifndef TAI_COMMON_TRACE_H
+#define TAI_COMMON_TRACE_H
+
+// Timeline of pipeline stages for --trace FILE, in Chrome trace format
+// (chrome://tracing, ui.perfetto.dev).
+//
+// TAI_TRACE_BLOCK(Name, block) records the rest of the enclosing scope as a
+// span of stage Name for block (encoder 1: frame, column or split block;
+// encoder 2: the first 512-byte block of the span; -1 for none);
+// TAI_TRACE(Name) takes the block of the span it is nested in on the same
+// thread. Until Trace::start() a scope costs one relaxed load and a branch,
+// like TAI_PHASE. With -DTAI_NO_TRACE the markers compile away.
+//
+//   read         waiting for input
+//   model        statistics: frequency tables, histograms, split points
+//   rate search  encoder 2's per-block findbest
+//   encode       coding a block (includes its model and rate search)
+//   decode       decoding a block
+//   write        writing output
+//   verify       --verify-inline decoding a block again
+//
+// Every thread appends to its own buffer without locking; a thread takes
+// the registry mutex once, for its first span. Buffers outlive their
+// threads (parallelFor starts new ones per call), so Trace::write() sees
+// every span once the workers are joined. Each buffer is one row in the
+// viewer: "main" for the thread that called start(), "worker N" for the rest.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tai {
+
+enum class Span : int {
+    Read,
+    Model,
+    RateSearch,
+    Encode,
+    Decode,
+    Write,
+    Verify,
+    COUNT
+};
+
+inline const char* spanName(Span span) {
+    static const char* const names[] = {
+        "read", "model", "rate search", "encode", "decode", "write", "verify"
+    };
+    return names[static_cast<int>(span)];
+}
+
+class Trace {
+public:
+    static const int64_t NO_BLOCK = -1;
+
+private:
+    struct Event {
+        int64_t begin, end;     // nanoseconds since start()
+        int64_t block;
+        Span span;
+    };
+
+    struct Buffer {
+        unsigned tid;
+        std::vector<Event> events;
+    };
+
+    std::atomic<bool> on{false};
+    std::chrono::steady_clock::time_point epoch;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+
+    static Trace& instance() {
+        static Trace trace;
+        return trace;
+    }
+
+    Buffer& local() {
+        thread_local Buffer* buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.emplace_back(new Buffer{static_cast<unsigned>(buffers.size()), {}});
+            buffer = buffers.back().get();
+            buffer->events.reserve(1024);
+        }
+        return *buffer;
+    }
+
+public:
+    static bool enabled() { return instance().on.load(std::memory_order_relaxed); }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - instance().epoch).count();
+    }
+
+    // Starts recording; the calling thread becomes "main".
+    static void start() {
+        Trace& t = instance();
+        t.epoch = std::chrono::steady_clock::now();
+        t.local();
+        t.on.store(true, std::memory_order_relaxed);
+    }
+
+    static void record(Span span, int64_t block, int64_t begin, int64_t end) {
+        instance().local().events.push_back({begin, end, block, span});
+    }
+
+    // Writes every span as a complete ("X") event, times in microseconds.
+    // Call once the threads that recorded are done; returns false if the
+    // file cannot be written.
+    static bool write(const std::string& path) {
+        Trace& t = instance();
+        std::lock_guard<std::mutex> lock(t.mutex);
+        std::ofstream out(path);
+        out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        for (const std::unique_ptr<Buffer>& b : t.buffers) {
+            out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+                << ",\"args\":{\"name\":\"" << (b->tid == 0 ? "main" : "worker " + std::to_string(b->tid))
+                << "\"}}";
+            first = false;
+            for (const Event& e : b->events) {
+                out << ",\n{\"name\":\"" << spanName(e.span) << "\",\"cat\":\"tai\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                    << b->tid << ",\"ts\":" << e.begin / 1000.0 << ",\"dur\":" << (e.end - e.begin) / 1000.0;
+                if (e.block != NO_BLOCK) out << ",\"args\":{\"block\":" << e.block << "}";
+                out << "}";
+            }
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+    // Block of the innermost open span on this thread.
+    static int64_t& currentBlock() {
+        thread_local int64_t block = NO_BLOCK;
+        return block;
+    }
+};
+
+class TraceScope {
+private:
+    bool active;
+    Span span;
+    int64_t block = Trace::NO_BLOCK, outer = Trace::NO_BLOCK, begin = 0;
+
+public:
+    TraceScope(Span s, int64_t b) : active(Trace::enabled()), span(s), block(b) {
+        if (!active) return;
+        outer = Trace::currentBlock();
+        Trace::currentBlock() = block;
+        begin = Trace::now();
+    }
+    explicit TraceScope(Span s) : active(Trace::enabled()), span(s) {
+        if (!active) return;
+        block = outer = Trace::currentBlock();
+        begin = Trace::now();
+    }
+    ~TraceScope() {
+        if (!active) return;
+        Trace::record(span, block, begin, Trace::now());
+        Trace::currentBlock() = outer;
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+} // namespace tai
+
+#ifdef TAI_NO_TRACE
+#define TAI_TRACE(name) do {} while (0)
+#define TAI_TRACE_BLOCK(name, block) do {} while (0)
+#else
+#define TAI_TRACE(name) ::tai::TraceScope tai_trace_scope_(::tai::Span::name)
+#define TAI_TRACE_BLOCK(name, block) \
+    ::tai::TraceScope tai_trace_scope_(::tai::Span::name, static_cast<int64_t>(block))
+#endif
+
+#endif
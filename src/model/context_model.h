@@ -0,0 +1,75 @@
+#ifndef TAI_MODEL_CONTEXT_MODEL_H
+#define TAI_MODEL_CONTEXT_MODEL_H
+
+// Per-bit machinery shared by the hashed context models. A model computes
+// its context hashes once per byte and hands them to set(); HashedContexts
+// looks up one BucketHashTable slot per context and nibble, feeds the
+// slots' predictions to the mixer and trains them on each coded bit.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../common/log_tables.h"
+#include "hash_table.h"
+#include "mixer.h"
+
+namespace tai {
+
+class HashedContexts {
+private:
+    BucketHashTable table;
+    std::vector<uint64_t> hashes;
+    std::vector<uint16_t*> slots;
+    int node = 1;               // position in the current nibble's tree, 1..15
+    int rate;
+
+    void lookup(uint64_t salt) {
+        for (size_t i = 0; i < hashes.size(); i++) {
+            slots[i] = table.find(hashCombine(hashes[i], salt));
+        }
+    }
+
+public:
+    // count contexts in one table of table_bytes; counters adapt by 1/2^rate.
+    HashedContexts(size_t count, size_t table_bytes, int adapt_rate = 4)
+        : table(table_bytes), hashes(count, 0), slots(count, nullptr), rate(adapt_rate) {
+        lookup(0);
+    }
+
+    size_t size() const {
+        return hashes.size();
+    }
+
+    // Context i for the next byte; call begin() once all are set.
+    void set(size_t i, uint64_t hash) {
+        hashes[i] = hashCombine(hash, i + 1);
+    }
+
+    void begin() {
+        node = 1;
+        lookup(0);
+    }
+
+    void predict(Mixer& mixer) const {
+        for (uint16_t* s : slots) {
+            mixer.add(stretch(s[node - 1] >> 4));
+        }
+    }
+
+    // c0 is the partial byte after bit (leading 1 bit, 256+ when complete).
+    void update(int bit, int c0) {
+        for (uint16_t* s : slots) {
+            updateBitProbability(s[node - 1], bit, rate);
+        }
+        node = node * 2 + bit;
+        if (node >= 16) {
+            node = 1;
+            if (c0 < 256) lookup(static_cast<uint64_t>(c0));
+        }
+    }
+};
+
+} // namespace tai
+
+#endif
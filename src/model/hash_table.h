@@ -0,0 +1,101 @@
+#ifndef TAI_MODEL_HASH_TABLE_H
+#define TAI_MODEL_HASH_TABLE_H
+
+// Bucketed hash table behind the context models.
+//
+// A context hash picks a 64-byte bucket (one cache line) of two slots; a
+// slot is a 16-bit check plus the 15 bit probabilities of one nibble's
+// binary tree, so a single lookup serves four bits. The check tells apart
+// contexts that share a bucket. On a miss the less recently used slot is
+// replaced, so a bucket keeps the two contexts seen last. The table starts
+// zeroed: hashes never produce check 0, so zeroed slots never match, and a
+// slot is set to p = 1/2 when it is claimed. The storage comes from calloc,
+// so a large table is mapped zero pages that cost nothing until touched; a
+// short input only pays for the buckets it reaches.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace tai {
+
+// Mixes v into the context hash h.
+inline uint64_t hashCombine(uint64_t h, uint64_t v) {
+    h = (h ^ v) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 29);
+}
+
+// Moves a 16-bit probability of a 1 bit 1/2^rate of the way towards bit.
+inline void updateBitProbability(uint16_t& p, int bit, int rate) {
+    if (bit) {
+        p = static_cast<uint16_t>(p + ((65535 - p) >> rate));
+    } else {
+        p = static_cast<uint16_t>(p - (p >> rate));
+    }
+}
+
+class BucketHashTable {
+public:
+    static const int NODES = 15;
+
+    struct Slot {
+        uint16_t check;
+        uint16_t p[NODES];      // node k of the nibble tree (k = 1..15) at p[k - 1]
+    };
+
+private:
+    struct alignas(64) Bucket {
+        Slot slot[2];           // most recently used first
+    };
+
+    struct Free {
+        void operator()(void* p) const { std::free(p); }
+    };
+
+    std::unique_ptr<void, Free> storage;
+    Bucket* buckets;
+    size_t mask;
+
+public:
+    // Uses the largest power-of-two number of buckets that fits in bytes
+    // (at least one).
+    explicit BucketHashTable(size_t bytes) {
+        size_t count = 1;
+        while (count * 2 * sizeof(Bucket) <= bytes) count *= 2;
+        // calloc only promises 16-byte alignment: round up to a cache line.
+        storage.reset(std::calloc(count * sizeof(Bucket) + alignof(Bucket), 1));
+        if (!storage) throw std::bad_alloc();
+        uintptr_t base = reinterpret_cast<uintptr_t>(storage.get());
+        buckets = reinterpret_cast<Bucket*>((base + alignof(Bucket) - 1) & ~uintptr_t(alignof(Bucket) - 1));
+        mask = count - 1;
+    }
+
+    // Returns the probabilities of the slot for hash, claiming one if the
+    // context is not in the table.
+    uint16_t* find(uint64_t hash) {
+        Bucket& b = buckets[static_cast<size_t>(hash) & mask];
+        uint16_t check = static_cast<uint16_t>(hash >> 48);
+        if (check == 0) check = 1;
+        if (b.slot[0].check == check) return b.slot[0].p;
+        if (b.slot[1].check == check) {
+            std::swap(b.slot[0], b.slot[1]);
+            return b.slot[0].p;
+        }
+        b.slot[1] = b.slot[0];
+        b.slot[0].check = check;
+        std::fill(b.slot[0].p, b.slot[0].p + NODES, uint16_t(32768));
+        return b.slot[0].p;
+    }
+
+    size_t bytes() const {
+        return (mask + 1) * sizeof(Bucket);
+    }
+};
+
+} // namespace tai
+
+#endif
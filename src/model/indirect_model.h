@@ -0,0 +1,55 @@
+#ifndef TAI_MODEL_INDIRECT_MODEL_H
+#define TAI_MODEL_INDIRECT_MODEL_H
+
+// Indirect contexts: for the last byte and the last two bytes, remember the
+// two bytes that followed their previous occurrences, and use that history
+// (with the context itself) as the context. It predicts what comes next
+// from what came next last time, which catches repeats that fixed-order
+// contexts see only after they have occurred in full.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "context_model.h"
+#include "mixer.h"
+
+namespace tai {
+
+class IndirectModel {
+private:
+    HashedContexts hashed;
+    std::vector<uint16_t> after1;   // by last byte: the two bytes that followed it
+    std::vector<uint16_t> after2;   // by last two bytes
+    uint32_t history = 0;
+
+public:
+    static const int INPUTS = 2;
+
+    explicit IndirectModel(size_t table_bytes)
+        : hashed(2, table_bytes), after1(256, 0), after2(65536, 0) {}
+
+    void predict(Mixer& mixer) const {
+        hashed.predict(mixer);
+    }
+
+    void update(int bit, int c0) {
+        hashed.update(bit, c0);
+    }
+
+    void byteEnd(unsigned char byte) {
+        uint16_t& a1 = after1[history & 0xFF];
+        uint16_t& a2 = after2[history & 0xFFFF];
+        a1 = static_cast<uint16_t>(a1 << 8 | byte);
+        a2 = static_cast<uint16_t>(a2 << 8 | byte);
+        history = history << 8 | byte;
+        uint32_t c1 = history & 0xFF, c2 = history & 0xFFFF;
+        hashed.set(0, hashCombine(c1, after1[c1]));
+        hashed.set(1, hashCombine(c2 | uint64_t(1) << 16, after2[c2]));
+        hashed.begin();
+    }
+};
+
+} // namespace tai
+
+#endif
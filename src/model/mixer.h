@@ -0,0 +1,68 @@
+#ifndef TAI_MODEL_MIXER_H
+#define TAI_MODEL_MIXER_H
+
+// Logistic mixer: combines the models' predictions in the stretch domain,
+// p = squash(sum w_i * stretch(p_i)), with one weight vector per selector
+// context, and trains the selected vector online on the coding cost
+// (w_i += rate * err * stretch(p_i)). Integer throughout, so encoder and
+// decoder compute the same weights on every machine.
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "../common/log_tables.h"
+
+namespace tai {
+
+class Mixer {
+private:
+    int inputs;
+    int rate;
+    std::vector<int32_t> weights;   // 16.16 fixed point, inputs per context
+    std::vector<int> stretched;
+    int count = 0;
+    size_t selected = 0;
+    int pr = 2048;
+
+public:
+    // rate scales the learning step; contexts is the number of weight sets.
+    Mixer(int input_count, int contexts, int learning_rate = 6)
+        : inputs(input_count), rate(learning_rate),
+          weights(static_cast<size_t>(input_count) * contexts, (1 << 16) / 4),
+          stretched(static_cast<size_t>(input_count), 0) {}
+
+    // Adds one input, already in the stretch domain ([-2047, 2047]).
+    void add(int st) {
+        stretched[count++] = st;
+    }
+
+    void select(int context) {
+        selected = static_cast<size_t>(context) * inputs;
+    }
+
+    // 12-bit probability of a 1 bit; every input must have been added.
+    int mix() {
+        const int32_t* w = &weights[selected];
+        int64_t dot = 0;
+        for (int i = 0; i < count; i++) {
+            dot += static_cast<int64_t>(w[i]) * stretched[i];
+        }
+        int d = static_cast<int>(std::max<int64_t>(-2047, std::min<int64_t>(2047, dot >> 16)));
+        pr = squash(d);
+        return pr;
+    }
+
+    void update(int bit) {
+        int err = ((bit << 12) - pr) * rate;
+        int32_t* w = &weights[selected];
+        for (int i = 0; i < count; i++) {
+            w[i] += (stretched[i] * err) >> 13;
+        }
+        count = 0;
+    }
+};
+
+} // namespace tai
+
+#endif
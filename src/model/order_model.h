@@ -0,0 +1,59 @@
+#ifndef TAI_MODEL_ORDER_MODEL_H
+#define TAI_MODEL_ORDER_MODEL_H
+
+// Byte contexts: the previous 0 and 1 bytes index direct tables, orders
+// 2, 3, 4 and 6 go through HashedContexts.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../common/log_tables.h"
+#include "context_model.h"
+#include "mixer.h"
+
+namespace tai {
+
+class OrderModel {
+private:
+    static const int ORDERS[4];
+
+    std::vector<uint16_t> order0;   // by partial byte
+    std::vector<uint16_t> order1;   // by previous byte and partial byte
+    HashedContexts hashed;
+    uint64_t history = 0;           // last 8 bytes, most recent lowest
+
+public:
+    static const int INPUTS = 2 + 4;
+
+    explicit OrderModel(size_t table_bytes)
+        : order0(256, 32768), order1(256 * 256, 32768), hashed(4, table_bytes) {}
+
+    void predict(Mixer& mixer, int c0) const {
+        mixer.add(stretch(order0[c0] >> 4));
+        mixer.add(stretch(order1[(history & 0xFF) << 8 | c0] >> 4));
+        hashed.predict(mixer);
+    }
+
+    void update(int bit, int c0_before, int c0) {
+        updateBitProbability(order0[c0_before], bit, 5);
+        updateBitProbability(order1[(history & 0xFF) << 8 | c0_before], bit, 4);
+        hashed.update(bit, c0);
+    }
+
+    void byteEnd(unsigned char byte) {
+        history = history << 8 | byte;
+        for (size_t i = 0; i < 4; i++) {
+            int order = ORDERS[i];
+            uint64_t mask = (uint64_t(1) << (8 * order)) - 1;
+            hashed.set(i, hashCombine(history & mask, static_cast<uint64_t>(order)));
+        }
+        hashed.begin();
+    }
+};
+
+inline const int OrderModel::ORDERS[4] = {2, 3, 4, 6};
+
+} // namespace tai
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef TAI_MODEL_PREDICTOR_H
+#define TAI_MODEL_PREDICTOR_H
+
+// Context-mixing bit predictor: byte contexts (OrderModel), word contexts
+// (WordModel) and indirect contexts (IndirectModel) mixed by one Mixer
+// whose weight set is chosen by the partial byte. Bytes are coded MSB
+// first; call p() before each bit and update() with the bit after it.
+//
+// Hash tables are sized from the input size, so small inputs do not pay
+// for clearing tables they cannot fill; encoder and decoder must pass the
+// same size_hint.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "indirect_model.h"
+#include "mixer.h"
+#include "order_model.h"
+#include "word_model.h"
+
+namespace tai {
+
+class ContextMixPredictor {
+private:
+    static const size_t MIN_TABLE = size_t(1) << 16;
+    static const size_t MAX_TABLE = size_t(1) << 23;    // per context
+
+    static size_t tableBytes(uint64_t size_hint) {
+        size_t bytes = MIN_TABLE;
+        while (bytes < MAX_TABLE && bytes < size_hint * 16) bytes *= 2;
+        return bytes;
+    }
+
+    OrderModel orders;
+    WordModel words;
+    IndirectModel indirect;
+    Mixer mixer;
+    int c0 = 1;                     // partial byte with a leading 1 bit
+
+public:
+    static const int INPUTS = OrderModel::INPUTS + WordModel::INPUTS + IndirectModel::INPUTS + 1;
+
+    explicit ContextMixPredictor(uint64_t size_hint)
+        : orders(4 * tableBytes(size_hint)),
+          words(2 * tableBytes(size_hint)),
+          indirect(2 * tableBytes(size_hint)),
+          mixer(INPUTS, 256) {}
+
+    // 12-bit probability that the next bit is 1, in [1, 4095].
+    int p() {
+        mixer.select(c0);
+        orders.predict(mixer, c0);
+        words.predict(mixer);
+        indirect.predict(mixer);
+        mixer.add(256);
+        return std::max(1, std::min(4095, mixer.mix()));
+    }
+
+    void update(int bit) {
+        mixer.update(bit);
+        int next = c0 * 2 + bit;
+        orders.update(bit, c0, next);
+        words.update(bit, next);
+        indirect.update(bit, next);
+        c0 = next;
+        if (c0 >= 256) {
+            unsigned char byte = static_cast<unsigned char>(c0);
+            orders.byteEnd(byte);
+            words.byteEnd(byte);
+            indirect.byteEnd(byte);
+            c0 = 1;
+        }
+    }
+};
+
+} // namespace tai
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef TAI_MODEL_WORD_MODEL_H
+#define TAI_MODEL_WORD_MODEL_H
+
+// Word contexts for text. A word is a run of ASCII letters, case-folded;
+// the contexts are the hash of the current (partial) word with the last
+// byte, and the current word with the previous whole word. Inside a word
+// this predicts its completion, and at a word boundary the following
+// separator and word, across any distance in bytes.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "context_model.h"
+#include "mixer.h"
+
+namespace tai {
+
+class WordModel {
+private:
+    HashedContexts hashed;
+    uint64_t word = 0;              // 0 between words
+    uint64_t previous = 0;
+
+public:
+    static const int INPUTS = 2;
+
+    explicit WordModel(size_t table_bytes) : hashed(2, table_bytes) {}
+
+    void predict(Mixer& mixer) const {
+        hashed.predict(mixer);
+    }
+
+    void update(int bit, int c0) {
+        hashed.update(bit, c0);
+    }
+
+    void byteEnd(unsigned char byte) {
+        unsigned char folded = static_cast<unsigned char>(byte | 0x20);
+        if (folded >= 'a' && folded <= 'z') {
+            word = hashCombine(word, folded);
+        } else if (word != 0) {
+            previous = word;
+            word = 0;
+        }
+        hashed.set(0, hashCombine(word, byte));
+        hashed.set(1, hashCombine(word, previous));
+        hashed.begin();
+    }
+};
+
+} // namespace tai
+
+#endif
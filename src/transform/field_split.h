@@ -0,0 +1,135 @@
+#ifndef TAI_TRANSFORM_FIELD_SPLIT_H
+#define TAI_TRANSFORM_FIELD_SPLIT_H
+
+// Field splitting for line-oriented delimited data (CSV, TSV, logs).
+//
+// Every line is cut at the delimiter and field i goes to column i, so each
+// column (timestamps, IDs, free text...) can be coded with its own model.
+// Fields keep their terminator: the delimiter when another field follows,
+// '\n' for the last field of a line. The last column takes the rest of the
+// line, delimiters included, so lines with more fields than columns, or
+// fewer, round-trip unchanged; join() re-interleaves by reading column 0
+// until its terminator, then column 1, and so on until a '\n'. Quoting is
+// not interpreted: a delimiter inside quotes only moves where the split
+// happens, never what comes back.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace tai {
+
+class FieldSplit {
+private:
+    static const size_t MIN_INPUT = 4096;
+    static const size_t SAMPLE_LINES = 1000;
+    static const size_t MAX_COLUMNS = 64;
+
+public:
+    struct Columns {
+        unsigned char delimiter = ',';
+        bool trailing_newline = true;    // false: the input's last line had no '\n'
+        std::vector<std::vector<unsigned char>> streams;
+    };
+
+    // Picks the delimiter (',', '\t', '|' or ';') that splits at least 80%
+    // of the first SAMPLE_LINES lines into the same number (>= 2) of fields;
+    // returns that number of columns, or 0 if the data is not delimited.
+    static size_t detect(const std::vector<unsigned char>& data, unsigned char& delimiter) {
+        if (data.size() < MIN_INPUT) return 0;
+        static const unsigned char candidates[] = {',', '\t', '|', ';'};
+        size_t best_columns = 0;
+        for (unsigned char d : candidates) {
+            std::vector<size_t> per_line;
+            size_t count = 0;
+            for (size_t i = 0; i < data.size() && per_line.size() < SAMPLE_LINES; i++) {
+                if (data[i] == d) count++;
+                else if (data[i] == '\n') {
+                    per_line.push_back(count);
+                    count = 0;
+                }
+            }
+            if (per_line.size() < 8) continue;
+            std::vector<size_t> sorted = per_line;
+            std::sort(sorted.begin(), sorted.end());
+            size_t mode = 0, mode_run = 0;
+            for (size_t i = 0; i < sorted.size();) {
+                size_t j = i;
+                while (j < sorted.size() && sorted[j] == sorted[i]) j++;
+                if (j - i > mode_run) {
+                    mode = sorted[i];
+                    mode_run = j - i;
+                }
+                i = j;
+            }
+            if (mode == 0 || mode_run * 10 < per_line.size() * 8) continue;
+            size_t columns = std::min(mode + 1, MAX_COLUMNS);
+            if (columns > best_columns) {
+                best_columns = columns;
+                delimiter = d;
+            }
+        }
+        return best_columns;
+    }
+
+    static Columns split(const std::vector<unsigned char>& data, unsigned char delimiter, size_t columns) {
+        Columns out;
+        out.delimiter = delimiter;
+        out.streams.resize(std::max<size_t>(columns, 1));
+        size_t last = out.streams.size() - 1;
+        for (auto& s : out.streams) s.reserve(data.size() / out.streams.size() + 16);
+        size_t column = 0;
+        for (unsigned char c : data) {
+            out.streams[column].push_back(c);
+            if (c == '\n') {
+                column = 0;
+            } else if (c == delimiter && column < last) {
+                column++;
+            }
+        }
+        if (!data.empty() && data.back() != '\n') {
+            out.trailing_newline = false;
+            out.streams[column].push_back('\n');
+        }
+        return out;
+    }
+
+    static void join(const Columns& in, std::vector<unsigned char>& out) {
+        out.clear();
+        if (in.streams.empty()) return;
+        size_t total = 0;
+        for (const auto& s : in.streams) total += s.size();
+        out.reserve(total);
+        size_t last = in.streams.size() - 1;
+        std::vector<size_t> pos(in.streams.size(), 0);
+        size_t column = 0;
+        for (;;) {
+            const std::vector<unsigned char>& s = in.streams[column];
+            size_t& p = pos[column];
+            if (p == s.size()) {
+                if (column == 0) break;
+                throw std::runtime_error("Corrupt field-split data");
+            }
+            size_t start = p;
+            bool splits = column < last;
+            while (p < s.size() && s[p] != '\n' && !(splits && s[p] == in.delimiter)) p++;
+            if (p == s.size()) throw std::runtime_error("Corrupt field-split data");
+            unsigned char c = s[p++];
+            out.insert(out.end(), s.begin() + start, s.begin() + p);
+            column = c == '\n' ? 0 : column + 1;
+        }
+        for (size_t i = 0; i < in.streams.size(); i++) {
+            if (pos[i] != in.streams[i].size()) throw std::runtime_error("Corrupt field-split data");
+        }
+        if (!in.trailing_newline) {
+            if (out.empty() || out.back() != '\n') throw std::runtime_error("Corrupt field-split data");
+            out.pop_back();
+        }
+    }
+};
+
+} // namespace tai
+
+#endif
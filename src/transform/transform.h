@@ -0,0 +1,88 @@
+#ifndef TAI_TRANSFORM_TRANSFORM_H
+#define TAI_TRANSFORM_TRANSFORM_H
+
+// Reversible preprocessing applied before the entropy coder. The forward
+// pass picks the transform from the data itself and keeps the result only
+// when it lowers the estimated order-0 cost, so binary or already-dense
+// inputs pass through untouched.
+//
+// FieldSplit (field_split.h) produces several sub-streams rather than one
+// buffer; encoder 1 codes and stores those as separate columns, so it has no
+// single-buffer inverse here.
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "../common/histogram.h"
+#include "../common/log_tables.h"
+#include "field_split.h"
+#include "word_dictionary.h"
+#include "x86_branch.h"
+
+namespace tai {
+
+enum class Transform : uint8_t {
+    None = 0,
+    WordDictionary = 1,
+    FieldSplit = 2,
+    X86Branch = 3,
+    LAST = X86Branch
+};
+
+// Order-0 coded size of data in bits (what encoder 1's static coders get
+// close to), excluding the symbol table.
+inline uint64_t order0CostBits(const ByteHistogram& h) {
+    uint64_t cost = 0;
+    for (int c = 0; c < 256; c++) {
+        cost += h.counts[c] * symbolCostFixed(h.counts[c], h.total);
+    }
+    return cost >> 16;
+}
+
+inline uint64_t order0CostBits(const std::vector<unsigned char>& data) {
+    return order0CostBits(ByteHistogram::of(data.data(), data.size()));
+}
+
+// order0CostBits plus encoder 1's symbol table (9 bytes per distinct byte).
+inline uint64_t storedCostBits(const std::vector<unsigned char>& data) {
+    ByteHistogram h = ByteHistogram::of(data.data(), data.size());
+    return order0CostBits(h) + (4 + 9 * static_cast<uint64_t>(h.distinct())) * 8;
+}
+
+// Sets out to the transformed data and returns the transform used, or
+// returns Transform::None (out cleared) when no transform pays off.
+inline Transform forwardTransform(const std::vector<unsigned char>& data, std::vector<unsigned char>& out) {
+    out.clear();
+    if (WordDictionary::encode(data, out) && order0CostBits(out) < order0CostBits(data)) {
+        return Transform::WordDictionary;
+    }
+    out.clear();
+    if (X86BranchFilter::detect(data)) {
+        X86BranchFilter::encode(data, out);
+        if (order0CostBits(out) < order0CostBits(data)) return Transform::X86Branch;
+    }
+    out.clear();
+    return Transform::None;
+}
+
+inline void inverseTransform(Transform t, const std::vector<unsigned char>& in, std::vector<unsigned char>& out) {
+    switch (t) {
+    case Transform::None:
+        out = in;
+        return;
+    case Transform::WordDictionary:
+        WordDictionary::decode(in, out);
+        return;
+    case Transform::X86Branch:
+        X86BranchFilter::decode(in, out);
+        return;
+    case Transform::FieldSplit:
+        break;
+    }
+    throw std::runtime_error("Unknown transform");
+}
+
+} // namespace tai
+
+#endif
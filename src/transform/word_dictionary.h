@@ -0,0 +1,262 @@
+#ifndef TAI_TRANSFORM_WORD_DICTIONARY_H
+#define TAI_TRANSFORM_WORD_DICTIONARY_H
+
+// Word-replacement transform for text.
+//
+// Frequent words (maximal runs of ASCII letters) are replaced by one- or
+// two-byte codes built from byte values that never occur in the input, so
+// the output needs no escaping and decoding is a table lookup per byte. The
+// dictionary is ranked by the bytes each word saves and stored in front of
+// the transformed data:
+//
+//   n1 n2 code[n1 + n2] uint32 word_count { len word }* data
+//
+// Word k < n1 is code[k]; word k >= n1 is code[n1 + (k - n1) / 256]
+// followed by (k - n1) % 256. Words are counted with an open-addressing hash
+// table over the input, so the tokenizer makes one pass and never copies.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "../common/histogram.h"
+
+namespace tai {
+
+class WordDictionary {
+private:
+    static const size_t MIN_INPUT = 4096;
+    static const size_t MAX_WORD = 64;
+    static const int MIN_CODE_BYTES = 8;
+
+    struct Word {
+        uint32_t offset;
+        uint32_t len;
+        uint64_t hash;
+        uint32_t count;
+        int32_t code;       // dictionary index, -1 if not in the dictionary
+    };
+
+    static bool isLetter(unsigned char c) {
+        return static_cast<unsigned char>((c | 0x20) - 'a') < 26;
+    }
+
+    static uint64_t hashWord(const unsigned char* p, size_t len) {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < len; i++) {
+            h = (h ^ p[i]) * 0x100000001b3ull;
+        }
+        return h;
+    }
+
+    // Open-addressing table of distinct words, keyed by their bytes in the
+    // input; grows at half load.
+    class WordTable {
+    private:
+        const unsigned char* data;
+        std::vector<int32_t> slots;     // index into words, -1 if empty
+        size_t mask;
+
+        void grow() {
+            std::vector<int32_t> old;
+            old.swap(slots);
+            slots.assign(old.size() * 2, -1);
+            mask = slots.size() - 1;
+            for (int32_t w : old) {
+                if (w < 0) continue;
+                size_t i = words[w].hash & mask;
+                while (slots[i] >= 0) i = (i + 1) & mask;
+                slots[i] = w;
+            }
+        }
+
+    public:
+        std::vector<Word> words;
+
+        explicit WordTable(const unsigned char* input) : data(input), slots(1024, -1), mask(1023) {}
+
+        // Returns the entry for data[offset, offset + len), adding it if new
+        // when insert is set; nullptr if absent otherwise.
+        Word* find(uint32_t offset, uint32_t len, uint64_t hash, bool insert) {
+            size_t i = hash & mask;
+            for (;;) {
+                int32_t w = slots[i];
+                if (w < 0) break;
+                Word& e = words[w];
+                if (e.hash == hash && e.len == len && std::memcmp(data + e.offset, data + offset, len) == 0) {
+                    return &e;
+                }
+                i = (i + 1) & mask;
+            }
+            if (!insert) return nullptr;
+            slots[i] = static_cast<int32_t>(words.size());
+            words.push_back({offset, len, hash, 0, -1});
+            if (words.size() * 2 > slots.size()) grow();
+            return &words.back();
+        }
+    };
+
+    // Calls fn(offset, len, hash) for every word in data.
+    template <typename Fn>
+    static void forEachWord(const unsigned char* data, size_t size, Fn&& fn) {
+        size_t i = 0;
+        while (i < size) {
+            if (!isLetter(data[i])) {
+                i++;
+                continue;
+            }
+            size_t start = i;
+            while (i < size && isLetter(data[i])) i++;
+            size_t len = i - start;
+            if (len >= 2 && len <= MAX_WORD) {
+                fn(static_cast<uint32_t>(start), static_cast<uint32_t>(len), hashWord(data + start, len));
+            }
+        }
+    }
+
+    static void putUint32(std::vector<unsigned char>& out, uint32_t v) {
+        for (int i = 0; i < 4; i++) out.push_back(static_cast<unsigned char>(v >> (24 - 8 * i)));
+    }
+
+public:
+    // Text: no NUL bytes and at least 97% printable ASCII, whitespace or
+    // UTF-8 continuation/lead bytes.
+    static bool looksLikeText(const std::vector<unsigned char>& data) {
+        if (data.size() < MIN_INPUT) return false;
+        ByteHistogram h = ByteHistogram::of(data.data(), data.size());
+        if (h.counts[0] > 0) return false;
+        uint64_t texty = h.counts['\t'] + h.counts['\n'] + h.counts['\r'];
+        for (int c = 0x20; c < 0x7F; c++) texty += h.counts[c];
+        for (int c = 0x80; c < 0x100; c++) texty += h.counts[c];
+        return texty * 100 >= h.total * 97;
+    }
+
+    // Writes the transformed data to out; returns false (out untouched) when
+    // the input is not text or there is nothing worth replacing.
+    static bool encode(const std::vector<unsigned char>& in, std::vector<unsigned char>& out) {
+        if (!looksLikeText(in) || in.size() > UINT32_MAX) return false;
+        ByteHistogram h = ByteHistogram::of(in.data(), in.size());
+        std::vector<unsigned char> free_bytes;
+        for (int c = 0; c < 256; c++) {
+            if (h.counts[c] == 0) free_bytes.push_back(static_cast<unsigned char>(c));
+        }
+        int unused = static_cast<int>(free_bytes.size());
+        if (unused < MIN_CODE_BYTES) return false;
+
+        WordTable table(in.data());
+        forEachWord(in.data(), in.size(), [&](uint32_t offset, uint32_t len, uint64_t hash) {
+            table.find(offset, len, hash, true)->count++;
+        });
+
+        // Rank by bytes saved with a one-byte code.
+        std::vector<uint32_t> ranked;
+        for (uint32_t w = 0; w < table.words.size(); w++) {
+            const Word& e = table.words[w];
+            if (e.count >= 2 && uint64_t(e.count) * (e.len - 1) > e.len + 1) ranked.push_back(w);
+        }
+        if (ranked.empty()) return false;
+        std::sort(ranked.begin(), ranked.end(), [&](uint32_t a, uint32_t b) {
+            const Word& x = table.words[a];
+            const Word& y = table.words[b];
+            uint64_t sx = uint64_t(x.count) * (x.len - 1), sy = uint64_t(y.count) * (y.len - 1);
+            return sx != sy ? sx > sy : x.offset < y.offset;
+        });
+
+        // Spend just enough code bytes on two-byte prefixes for the ranked
+        // words that do not get a one-byte code.
+        int n2 = 0;
+        while (n2 < unused / 2 && static_cast<size_t>(unused - n2) + size_t(n2) * 256 < ranked.size()) n2++;
+        int n1 = unused - n2;
+        size_t capacity = size_t(n1) + size_t(n2) * 256;
+        std::vector<uint32_t> dictionary;
+        for (size_t k = 0; k < ranked.size() && dictionary.size() < capacity; k++) {
+            const Word& e = table.words[ranked[k]];
+            bool two_bytes = dictionary.size() >= static_cast<size_t>(n1);
+            if (two_bytes && uint64_t(e.count) * (e.len - 2) <= e.len + 1) continue;
+            table.words[ranked[k]].code = static_cast<int32_t>(dictionary.size());
+            dictionary.push_back(ranked[k]);
+        }
+
+        out.clear();
+        out.reserve(in.size());
+        out.push_back(static_cast<unsigned char>(n1));
+        out.push_back(static_cast<unsigned char>(n2));
+        out.insert(out.end(), free_bytes.begin(), free_bytes.end());
+        putUint32(out, static_cast<uint32_t>(dictionary.size()));
+        for (uint32_t w : dictionary) {
+            const Word& e = table.words[w];
+            out.push_back(static_cast<unsigned char>(e.len));
+            out.insert(out.end(), in.begin() + e.offset, in.begin() + e.offset + e.len);
+        }
+
+        size_t copied = 0;
+        forEachWord(in.data(), in.size(), [&](uint32_t offset, uint32_t len, uint64_t hash) {
+            const Word* e = table.find(offset, len, hash, false);
+            int32_t code = e ? e->code : -1;
+            if (code < 0) return;
+            out.insert(out.end(), in.begin() + copied, in.begin() + offset);
+            copied = offset + len;
+            if (code < n1) {
+                out.push_back(free_bytes[code]);
+            } else {
+                out.push_back(free_bytes[n1 + (code - n1) / 256]);
+                out.push_back(static_cast<unsigned char>((code - n1) % 256));
+            }
+        });
+        out.insert(out.end(), in.begin() + copied, in.end());
+        return true;
+    }
+
+    static void decode(const std::vector<unsigned char>& in, std::vector<unsigned char>& out) {
+        auto fail = [] { throw std::runtime_error("Corrupt word dictionary"); };
+        size_t pos = 0;
+        if (in.size() < 2) fail();
+        int n1 = in[pos++];
+        int n2 = in[pos++];
+        if (in.size() < pos + n1 + n2 + 4) fail();
+        int16_t single[256], prefix[256];
+        std::fill(single, single + 256, -1);
+        std::fill(prefix, prefix + 256, -1);
+        for (int k = 0; k < n1 + n2; k++) {
+            unsigned char c = in[pos++];
+            if (k < n1) single[c] = static_cast<int16_t>(k);
+            else prefix[c] = static_cast<int16_t>(k - n1);
+        }
+        uint32_t count = 0;
+        for (int i = 0; i < 4; i++) count = (count << 8) | in[pos++];
+        if (count > size_t(n1) + size_t(n2) * 256) fail();
+        std::vector<std::pair<size_t, size_t>> words(count);    // offset, length in `in`
+        for (uint32_t k = 0; k < count; k++) {
+            if (pos >= in.size()) fail();
+            size_t len = in[pos++];
+            if (pos + len > in.size()) fail();
+            words[k] = {pos, len};
+            pos += len;
+        }
+
+        out.clear();
+        out.reserve(in.size() * 2);
+        auto emit = [&](size_t k) {
+            if (k >= words.size()) fail();
+            out.insert(out.end(), in.begin() + words[k].first, in.begin() + words[k].first + words[k].second);
+        };
+        while (pos < in.size()) {
+            unsigned char c = in[pos++];
+            if (single[c] >= 0) {
+                emit(static_cast<size_t>(single[c]));
+            } else if (prefix[c] >= 0) {
+                if (pos >= in.size()) fail();
+                emit(size_t(n1) + size_t(prefix[c]) * 256 + in[pos++]);
+            } else {
+                out.push_back(c);
+            }
+        }
+    }
+};
+
+} // namespace tai
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef TAI_TRANSFORM_X86_BRANCH_H
+#define TAI_TRANSFORM_X86_BRANCH_H
+
+// E8/E9 filter for x86 machine code.
+//
+// CALL (E8) and JMP (E9) take a 32-bit displacement relative to the next
+// instruction, so repeated calls to one function all carry different bytes.
+// Adding the instruction's offset turns them into the absolute target, which
+// repeats. Only displacements whose top byte is 0x00 or 0xFF (within 16 MiB,
+// which covers nearly all real branches) are converted, and only their low
+// 24 bits, modulo 2^24: the top byte is left alone, so the decoder sees the
+// same condition and subtracts again. Opcode bytes themselves never change
+// and the scan skips the 4 displacement bytes after each one, so both sides
+// visit the same positions.
+//
+// The filter is stateful so it can run over a stream in pieces: encode() and
+// decode() convert in place and return how many leading bytes are final; an
+// opcode too close to the end of the piece is left for the next call, which
+// must start with the unfinished bytes.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../common/byte_scan.h"
+
+namespace tai {
+
+class X86BranchFilter {
+private:
+    static const size_t MIN_INPUT = 4096;
+    static const size_t SAMPLE_BYTES = size_t(1) << 20;
+
+    uint64_t position = 0;      // stream offset of the next byte passed in
+
+    static bool nearDisplacement(const unsigned char* p) {
+        return p[4] == 0x00 || p[4] == 0xFF;
+    }
+
+    size_t convert(unsigned char* data, size_t size, bool last, bool encoding) {
+        size_t i = 0;
+        for (;;) {
+            i += findMasked(data + i, size - i, 0xFE, 0xE8);
+            if (i + 5 > size) {
+                if (!last && i < size) break;
+                i = size;
+                break;
+            }
+            unsigned char* p = data + i;
+            if (nearDisplacement(p)) {
+                uint32_t offset = static_cast<uint32_t>(position + i + 5);
+                uint32_t low = p[1] | (uint32_t(p[2]) << 8) | (uint32_t(p[3]) << 16);
+                low = (encoding ? low + offset : low - offset) & 0xFFFFFF;
+                p[1] = static_cast<unsigned char>(low);
+                p[2] = static_cast<unsigned char>(low >> 8);
+                p[3] = static_cast<unsigned char>(low >> 16);
+            }
+            i += 5;
+        }
+        position += i;
+        return i;
+    }
+
+public:
+    // Converts data[0, size) in place and returns the number of leading
+    // bytes that are final; the rest (fewer than 5 bytes) must be passed
+    // again at the start of the next call. With last set, everything is
+    // final.
+    size_t encode(unsigned char* data, size_t size, bool last) {
+        return convert(data, size, last, true);
+    }
+
+    size_t decode(unsigned char* data, size_t size, bool last) {
+        return convert(data, size, last, false);
+    }
+
+    // Cheap test for x86 code on the first SAMPLE_BYTES: enough E8/E9
+    // opcodes whose branch target lands inside the sample, which random or
+    // text data almost never produces.
+    static bool detect(const unsigned char* data, size_t size) {
+        if (size < MIN_INPUT) return false;
+        size_t n = size < SAMPLE_BYTES ? size : SAMPLE_BYTES;
+        size_t candidates = 0, in_range = 0;
+        for (size_t i = findMasked(data, n, 0xFE, 0xE8); i + 5 <= n;
+             i += 1 + findMasked(data + i + 1, n - i - 1, 0xFE, 0xE8)) {
+            candidates++;
+            int32_t rel = static_cast<int32_t>(data[i + 1] | (uint32_t(data[i + 2]) << 8) |
+                                               (uint32_t(data[i + 3]) << 16) | (uint32_t(data[i + 4]) << 24));
+            int64_t target = static_cast<int64_t>(i) + 5 + rel;
+            if (target >= 0 && target < static_cast<int64_t>(n)) in_range++;
+        }
+        return in_range >= 16 && in_range * 1024 >= n && in_range * 8 >= candidates;
+    }
+
+    static bool detect(const std::vector<unsigned char>& data) {
+        return detect(data.data(), data.size());
+    }
+
+    // Whole-buffer forms.
+    static void encode(const std::vector<unsigned char>& in, std::vector<unsigned char>& out) {
+        out = in;
+        X86BranchFilter().encode(out.data(), out.size(), true);
+    }
+
+    static void decode(const std::vector<unsigned char>& in, std::vector<unsigned char>& out) {
+        out = in;
+        X86BranchFilter().decode(out.data(), out.size(), true);
+    }
+};
+
+} // namespace tai
+
+#endif